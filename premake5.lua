@@ -1,10 +1,21 @@
 
+newoption {
+   trigger     = "avx",
+   description = "Build the SIMD kernels for AVX instead of SSE2 (the binary then needs an AVX capable CPU)"
+}
+
 -- A solution contains projects, and defines the available configurations
 solution "graphicsByExample"
    configurations { "Debug", "Release"}
 
    flags { "Unicode" , "NoPCH"}
 
+   if _OPTIONS["avx"] then
+      vectorextensions "AVX"
+   else
+      vectorextensions "SSE2"
+   end
+
    srcDirs = os.matchdirs("src/*")
 
    for i, projectName in ipairs(srcDirs) do
@@ -20,7 +31,7 @@ solution "graphicsByExample"
              buildoptions ""
              linkoptions { "/NODEFAULTLIB:msvcrt" } -- https://github.com/yuriks/robotic/blob/master/premake5.lua
           configuration { "linux" }
-             buildoptions "-std=c++11" --http://industriousone.com/topic/xcode4-c11-build-option
+             buildoptions "-std=c++11 -pthread" --http://industriousone.com/topic/xcode4-c11-build-option
              toolset "gcc"
           configuration {}
 
@@ -48,7 +59,7 @@ solution "graphicsByExample"
           configuration "windows"
              links { "SDL2", "SDL2main", "opengl32", "glew32" }
           configuration "linux"
-             links { "SDL2", "SDL2main", "GL", "GLEW" }
+             links { "SDL2", "SDL2main", "GL", "GLEW", "EGL", "pthread" } -- EGL for the offscreen backend
           configuration {}
 
 
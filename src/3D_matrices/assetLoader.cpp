@@ -0,0 +1,153 @@
+#include "assetLoader.h"
+#include "timing.h"
+#include "traceEvents.h"
+
+#include <algorithm>
+#include <iostream>
+
+// tag::AssetLoader[]
+AssetLoader::AssetLoader()
+	: meshPool(nullptr), positionLocation(-1), colorLocation(-1), budgetMs(2.0), stopping(false),
+	  pending(0), bytesUploaded(0), worstFrameMs(0.0)
+{
+}
+
+AssetLoader::~AssetLoader()
+{
+	shutdown();
+}
+
+void AssetLoader::initialise(MeshPool &pool, GLint positionLocation, GLint colorLocation, double uploadBudgetMilliseconds)
+{
+	meshPool = &pool;
+	this->positionLocation = positionLocation;
+	this->colorLocation = colorLocation;
+	budgetMs = uploadBudgetMilliseconds;
+
+	stopping = false;
+	worker = std::thread(&AssetLoader::workerMain, this);
+	std::cout << "Asset loader running on its own thread (upload budget " << budgetMs << " ms a frame)\n";
+}
+
+void AssetLoader::shutdown()
+{
+	if (!worker.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueReady.notify_one();
+	worker.join();
+
+	//anything still waiting never completes - its future reports a broken promise
+	for (size_t i = 0; i < uploading.size(); i++)
+		glDeleteSync(uploading[i]->fence);
+	uploading.clear();
+	toDecode.clear();
+	decoded.clear();
+	pending = 0;
+
+	std::cout << "Asset loader: uploaded " << bytesUploaded << " bytes, worst frame spent " << worstFrameMs << " ms uploading" << std::endl;
+}
+
+std::shared_future<int> AssetLoader::loadMesh(const std::string &name, MeshDecoder decode)
+{
+	MeshLoadPtr load = std::make_shared<MeshLoad>();
+	load->name = name;
+	load->decode = decode;
+	load->meshId = -1;
+	load->fence = 0;
+	load->requestTime = nowNanoseconds();
+	std::shared_future<int> future = load->promise.get_future().share();
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		toDecode.push_back(load);
+	}
+	queueReady.notify_one();
+	pending++;
+	return future;
+}
+
+void AssetLoader::workerMain()
+{
+	setTraceThreadName("asset loader");
+	std::unique_lock<std::mutex> lock(queueMutex);
+	while (true)
+	{
+		queueReady.wait(lock, [this] { return stopping || !toDecode.empty(); });
+		if (stopping)
+			return;
+
+		MeshLoadPtr load = toDecode.front();
+		toDecode.pop_front();
+
+		lock.unlock();
+		{
+			TRACE_SCOPE("decodeMesh");
+			load->decode(load->mesh);
+		}
+		lock.lock();
+
+		decoded.push_back(load);
+	}
+}
+
+void AssetLoader::update()
+{
+	//loads whose data the GPU now has are done - flush, so a fence we're polling always gets to the GPU
+	for (size_t i = 0; i < uploading.size(); )
+	{
+		MeshLoad &load = *uploading[i];
+		GLenum status = glClientWaitSync(load.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+		{
+			glDeleteSync(load.fence);
+			std::cout << "Asset \"" << load.name << "\" loaded OK! mesh " << load.meshId << " after "
+			          << (nowNanoseconds() - load.requestTime) * 1e-6 << " ms" << std::endl;
+			load.promise.set_value(load.meshId);
+			uploading[i] = uploading.back();
+			uploading.pop_back();
+			pending--;
+		}
+		else
+			i++;
+	}
+
+	//upload finished decodes until the budget runs out - always at least one, so a tiny budget still makes progress
+	long long start = nowNanoseconds();
+	double spentMs = 0.0;
+	while (spentMs < budgetMs)
+	{
+		MeshLoadPtr load;
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			if (decoded.empty())
+				break;
+			load = decoded.front();
+			decoded.pop_front();
+		}
+
+		//a mesh the decoder couldn't build - nothing to upload, and nothing to wait for
+		if (load->mesh.indices.empty())
+		{
+			std::cerr << "Asset \"" << load->name << "\" failed to load - its mesh is empty" << std::endl;
+			load->promise.set_value(-1);
+			pending--;
+			continue;
+		}
+
+		TRACE_SCOPE("uploadMesh");
+		load->meshId = meshPool->add(load->mesh);
+		bytesUploaded += meshPool->upload(positionLocation, colorLocation);
+		load->mesh = IndexedMesh(); //the pool has its own copy
+		load->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		uploading.push_back(load);
+
+		spentMs = (nowNanoseconds() - start) * 1e-6;
+	}
+	worstFrameMs = std::max(worstFrameMs, spentMs);
+}
+// end::AssetLoader[]
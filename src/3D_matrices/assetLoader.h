@@ -0,0 +1,89 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "mesh.h"
+
+// tag::AssetLoader[]
+//loads meshes without holding up the frame loop
+//  - the CPU work (reading, building, packing) runs on the loader's own thread, which never touches GL - so
+//    there's no second context to share, and nothing to go wrong with the driver
+//  - update(), once a frame on the GL thread, hands finished meshes to the mesh pool, but stops once the
+//    frame's upload budget is used - a big load is spread over frames instead of causing a hitch
+//  - each upload is fenced; a load's future is only ready once the GPU has the data, so drawing it never
+//    waits for the copy
+//  - loadMesh() returns a future of the mesh id - check it each frame (isReady()), don't wait on it; the id is -1
+//    if the decoder left the mesh empty
+class AssetLoader
+{
+public:
+	typedef std::function<void(IndexedMesh &mesh)> MeshDecoder; //runs on the loader thread
+
+	AssetLoader();
+	~AssetLoader();
+
+	//needs a current GL context - the locations are passed on to MeshPool::upload
+	void initialise(MeshPool &pool, GLint positionLocation, GLint colorLocation, double uploadBudgetMilliseconds);
+	void shutdown();
+
+	std::shared_future<int> loadMesh(const std::string &name, MeshDecoder decode);
+
+	void update(); //once a frame, on the GL thread - uploads within the budget, and completes loads whose fences have passed
+
+	size_t pendingCount() const { return pending; }
+	long long uploadedBytes() const { return bytesUploaded; }
+	double worstFrameMilliseconds() const { return worstFrameMs; } //longest update() spent uploading
+
+private:
+	struct MeshLoad
+	{
+		std::string name;
+		MeshDecoder decode;
+		IndexedMesh mesh;
+		std::promise<int> promise;
+		int meshId;
+		GLsync fence;
+		long long requestTime;
+	};
+	typedef std::shared_ptr<MeshLoad> MeshLoadPtr;
+
+	void workerMain();
+
+	MeshPool *meshPool;
+	GLint positionLocation, colorLocation;
+	double budgetMs;
+
+	std::thread worker;
+	std::mutex queueMutex;
+	std::condition_variable queueReady;
+	bool stopping;
+	std::deque<MeshLoadPtr> toDecode; //waiting for the loader thread - guarded by queueMutex
+	std::deque<MeshLoadPtr> decoded; //waiting for an upload - guarded by queueMutex
+	std::vector<MeshLoadPtr> uploading; //uploaded, waiting for their fence - GL thread only
+
+	size_t pending;
+	long long bytesUploaded;
+	double worstFrameMs;
+};
+
+//true once a load has finished - never blocks
+template <typename T>
+bool isReady(const std::shared_future<T> &future)
+{
+	return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+// end::AssetLoader[]
+
+#endif
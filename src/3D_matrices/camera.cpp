@@ -0,0 +1,86 @@
+#include "camera.h"
+#include "glState.h"
+
+#include <iostream>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+Camera::Camera()
+	: eye(0.0f, 0.0f, 3.0f), target(0.0f), up(0.0f, 1.0f, 0.0f), fovY(45.0f), nearPlane(0.1f), farPlane(10.0f),
+	  width(600), height(600), viewDirty(true), projectionDirty(true), uniformBuffer(0), uploads(0)
+{
+}
+
+// tag::initialise[]
+void Camera::initialise()
+{
+	glGenBuffers(1, &uniformBuffer);
+	glState.bindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), nullptr, GL_DYNAMIC_DRAW);
+	glState.bindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, uniformBuffer); //once, for every program
+	std::cout << "Camera uniform buffer created OK! GLUint is: " << uniformBuffer << std::endl;
+
+	viewDirty = projectionDirty = true; //upload on the first update()
+}
+
+void Camera::shutdown()
+{
+	glState.deleteBuffers(1, &uniformBuffer);
+	uniformBuffer = 0;
+}
+
+void Camera::attachProgram(GLuint program)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(program, "Camera");
+	if (blockIndex == GL_INVALID_INDEX)
+		return;
+	glUniformBlockBinding(program, blockIndex, CAMERA_BLOCK_BINDING);
+}
+// end::initialise[]
+
+void Camera::lookAt(const glm::vec3 &newEye, const glm::vec3 &newTarget, const glm::vec3 &newUp)
+{
+	eye = newEye;
+	target = newTarget;
+	up = newUp;
+	viewDirty = true;
+}
+
+void Camera::setPerspective(float newFovY, float newNearPlane, float newFarPlane)
+{
+	fovY = newFovY;
+	nearPlane = newNearPlane;
+	farPlane = newFarPlane;
+	projectionDirty = true;
+}
+
+void Camera::setViewport(int newWidth, int newHeight)
+{
+	if (newWidth <= 0 || newHeight <= 0) //minimised
+		return;
+	if (newWidth == width && newHeight == height)
+		return;
+	width = newWidth;
+	height = newHeight;
+	projectionDirty = true;
+}
+
+// tag::update[]
+void Camera::update()
+{
+	if (!viewDirty && !projectionDirty)
+		return;
+
+	if (viewDirty)
+		block.view = glm::lookAt(eye, target, up);
+	if (projectionDirty)
+		block.projection = glm::perspective(fovY, (float)width / (float)height, nearPlane, farPlane);
+	block.viewProjection = block.projection * block.view;
+	viewFrustum = extractFrustum(block.viewProjection);
+	viewDirty = projectionDirty = false;
+
+	glState.bindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &block);
+	uploads++;
+}
+// end::update[]
@@ -0,0 +1,63 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+#include "frustum.h"
+
+// tag::CameraBlock[]
+//the uniform block every program shares - must match `Camera` in the GLSL
+//  - std140: each mat4 is four vec4 columns, so there's no padding to worry about
+struct CameraBlock
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection; //projection * view, so the vertex shader does one matrix multiply instead of two
+};
+
+const GLuint CAMERA_BLOCK_BINDING = 0; //uniform buffer binding point the camera block lives at
+// end::CameraBlock[]
+
+// tag::Camera[]
+//view and projection matrices, kept in a uniform buffer
+//  - the matrices are only recomputed and uploaded when something changed (the camera moved, the window
+//    was resized) - most frames update() does nothing
+//  - the buffer is bound to CAMERA_BLOCK_BINDING once; each program just points its `Camera` block at that binding
+class Camera
+{
+public:
+	Camera();
+
+	void initialise(); //needs a current GL context
+	void shutdown();
+	void attachProgram(GLuint program); //programs without a `Camera` block are left alone
+
+	void lookAt(const glm::vec3 &eye, const glm::vec3 &target, const glm::vec3 &up);
+	void setPerspective(float fovY, float nearPlane, float farPlane); //fovY in radians
+	void setViewport(int width, int height);
+
+	void update(); //recompute and upload, if dirty
+
+	const CameraBlock &matrices() const { return block; }
+	const Frustum &frustum() const { return viewFrustum; } //from the same viewProjection - as of the last update()
+	float farDistance() const { return farPlane; }
+	float projectionScale() const { return block.projection[1][1] * 0.5f * height; } //pixels per world unit, at distance 1
+	long long uploadCount() const { return uploads; }
+
+private:
+	glm::vec3 eye, target, up;
+	float fovY, nearPlane, farPlane;
+	int width, height;
+	bool viewDirty, projectionDirty;
+
+	CameraBlock block;
+	Frustum viewFrustum;
+	GLuint uniformBuffer;
+	long long uploads;
+};
+// end::Camera[]
+
+#endif
@@ -0,0 +1,216 @@
+#include "collision.h"
+
+#include <algorithm>
+#include <cmath>
+
+// tag::collideWithArena[]
+void collideWithArena(EntityStore &entities, size_t begin, size_t end, const ArenaBounds &arena)
+{
+	float *position[3] = { entities.posX.data(), entities.posY.data(), entities.posZ.data() };
+	float *velocity[3] = { entities.velX.data(), entities.velY.data(), entities.velZ.data() };
+	const float *half[3] = { entities.halfX.data(), entities.halfY.data(), entities.halfZ.data() };
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			float low = arena.min[axis] + half[axis][i];
+			float high = arena.max[axis] - half[axis][i];
+
+			//mirror back by the overshoot (clamped, for boxes that don't fit or huge steps), and
+			//  only reverse when heading into the wall, so we can't get stuck flipping back and forth
+			if (position[axis][i] < low)
+			{
+				position[axis][i] = std::min(low + (low - position[axis][i]), high);
+				if (velocity[axis][i] < 0.0f)
+					velocity[axis][i] = -velocity[axis][i];
+			}
+			else if (position[axis][i] > high)
+			{
+				position[axis][i] = std::max(high - (position[axis][i] - high), low);
+				if (velocity[axis][i] > 0.0f)
+					velocity[axis][i] = -velocity[axis][i];
+			}
+		}
+	}
+}
+// end::collideWithArena[]
+
+// tag::resolveCollisions[]
+size_t resolveCollisions(EntityStore &entities, const std::vector<CollisionPair> &pairs)
+{
+	float *position[3] = { entities.posX.data(), entities.posY.data(), entities.posZ.data() };
+	float *velocity[3] = { entities.velX.data(), entities.velY.data(), entities.velZ.data() };
+	const float *half[3] = { entities.halfX.data(), entities.halfY.data(), entities.halfZ.data() };
+
+	size_t contacts = 0;
+	for (size_t p = 0; p < pairs.size(); p++)
+	{
+		uint32_t a = pairs[p].a;
+		uint32_t b = pairs[p].b;
+		bool aIsPaddle = entities.kind[a] == ENTITY_PADDLE;
+		bool bIsPaddle = entities.kind[b] == ENTITY_PADDLE;
+		if (aIsPaddle && bIsPaddle)
+			continue;
+
+		//an earlier pair may already have pushed these apart - find the axis of least penetration
+		int normalAxis = -1;
+		float depth = 0.0f;
+		float direction = 1.0f; //sign of the normal, pointing from a to b
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float separation = position[axis][b] - position[axis][a];
+			float axisDepth = half[axis][a] + half[axis][b] - std::fabs(separation);
+			if (axisDepth <= 0.0f)
+			{
+				normalAxis = -1;
+				break;
+			}
+			if (normalAxis == -1 || axisDepth < depth)
+			{
+				normalAxis = axis;
+				depth = axisDepth;
+				direction = (separation < 0.0f) ? -1.0f : 1.0f;
+			}
+		}
+		if (normalAxis == -1)
+			continue;
+		contacts++;
+
+		float *axisPosition = position[normalAxis];
+		float *axisVelocity = velocity[normalAxis];
+		float closingSpeed = (axisVelocity[b] - axisVelocity[a]) * direction; //negative when approaching
+
+		if (aIsPaddle || bIsPaddle)
+		{
+			//push the ball all the way out, and bounce it relative to the paddle
+			uint32_t paddle = aIsPaddle ? a : b;
+			uint32_t ball = aIsPaddle ? b : a;
+			float ballDirection = aIsPaddle ? direction : -direction;
+			axisPosition[ball] += depth * ballDirection;
+			if (closingSpeed < 0.0f)
+				axisVelocity[ball] = 2.0f * axisVelocity[paddle] - axisVelocity[ball];
+		}
+		else
+		{
+			//two equal balls - split the push, and swap their speeds along the normal (elastic collision)
+			axisPosition[a] -= 0.5f * depth * direction;
+			axisPosition[b] += 0.5f * depth * direction;
+			if (closingSpeed < 0.0f)
+			{
+				float swap = axisVelocity[a];
+				axisVelocity[a] = axisVelocity[b];
+				axisVelocity[b] = swap;
+			}
+		}
+	}
+	return contacts;
+}
+// end::resolveCollisions[]
+
+// tag::sweptAabb[]
+bool sweptAabb(const glm::vec3 &aCentre, const glm::vec3 &aHalf, const glm::vec3 &displacement,
+               const glm::vec3 &bCentre, const glm::vec3 &bHalf, float &timeOfImpact, int &normalAxis)
+{
+	//shrink a to a point and grow b by a's size (Minkowski sum) - then it's a ray against a box, one slab per axis
+	float entry = -1e30f;
+	float exit = 1e30f;
+	int entryAxis = -1;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float low = bCentre[axis] - bHalf[axis] - aHalf[axis] - aCentre[axis];
+		float high = bCentre[axis] + bHalf[axis] + aHalf[axis] - aCentre[axis];
+
+		if (displacement[axis] == 0.0f)
+		{
+			if (low >= 0.0f || high <= 0.0f)
+				return false; //not moving on this axis, and not overlapping on it either
+			continue;
+		}
+
+		float axisEntry = low / displacement[axis];
+		float axisExit = high / displacement[axis];
+		if (axisEntry > axisExit)
+			std::swap(axisEntry, axisExit);
+
+		if (axisEntry > entry)
+		{
+			entry = axisEntry;
+			entryAxis = axis;
+		}
+		exit = std::min(exit, axisExit);
+	}
+
+	if (entryAxis == -1 || entry > exit || entry < 0.0f || entry > 1.0f)
+		return false;
+
+	timeOfImpact = entry;
+	normalAxis = entryAxis;
+	return true;
+}
+// end::sweptAabb[]
+
+// tag::sweepBallsAgainstPaddles[]
+size_t sweepBallsAgainstPaddles(EntityStore &entities, const std::vector<CollisionPair> &pairs, float dt)
+{
+	struct Hit
+	{
+		uint32_t ball;
+		uint32_t paddle;
+		float time;
+		int axis;
+	};
+	std::vector<Hit> hits;
+
+	for (size_t p = 0; p < pairs.size(); p++)
+	{
+		uint32_t a = pairs[p].a;
+		uint32_t b = pairs[p].b;
+		if ((entities.kind[a] == ENTITY_PADDLE) == (entities.kind[b] == ENTITY_PADDLE))
+			continue; //ball vs ball and paddle vs paddle are left to the narrowphase
+
+		Hit hit;
+		hit.ball = (entities.kind[a] == ENTITY_BALL) ? a : b;
+		hit.paddle = (hit.ball == a) ? b : a;
+
+		//work in the paddle's frame, so it's a moving box against a stationary one
+		glm::vec3 relativeVelocity(entities.velX[hit.ball] - entities.velX[hit.paddle],
+		                           entities.velY[hit.ball] - entities.velY[hit.paddle],
+		                           entities.velZ[hit.ball] - entities.velZ[hit.paddle]);
+		glm::vec3 ballHalf(entities.halfX[hit.ball], entities.halfY[hit.ball], entities.halfZ[hit.ball]);
+		glm::vec3 paddleHalf(entities.halfX[hit.paddle], entities.halfY[hit.paddle], entities.halfZ[hit.paddle]);
+
+		if (sweptAabb(entities.position(hit.ball), ballHalf, relativeVelocity * dt,
+		              entities.position(hit.paddle), paddleHalf, hit.time, hit.axis))
+			hits.push_back(hit);
+	}
+
+	//a ball can only bounce off the first paddle it reaches
+	std::sort(hits.begin(), hits.end(), [](const Hit &x, const Hit &y)
+	{
+		return (x.ball != y.ball) ? (x.ball < y.ball) : (x.time < y.time);
+	});
+
+	float *position[3] = { entities.posX.data(), entities.posY.data(), entities.posZ.data() };
+	float *velocity[3] = { entities.velX.data(), entities.velY.data(), entities.velZ.data() };
+
+	size_t bounces = 0;
+	for (size_t h = 0; h < hits.size(); h++)
+	{
+		if (h > 0 && hits[h].ball == hits[h - 1].ball)
+			continue;
+		const Hit &hit = hits[h];
+
+		float *axisVelocity = velocity[hit.axis];
+		float bounced = 2.0f * axisVelocity[hit.paddle] - axisVelocity[hit.ball]; //reflected relative to the paddle
+
+		//travel hit.time * dt at the old speed, then the rest at the new one - but integration will
+		//  apply the new speed for the whole of dt, so take off what it will add too much
+		position[hit.axis][hit.ball] += (axisVelocity[hit.ball] - bounced) * hit.time * dt;
+		axisVelocity[hit.ball] = bounced;
+		bounces++;
+	}
+	return bounces;
+}
+// end::sweepBallsAgainstPaddles[]
@@ -0,0 +1,44 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <cstddef>
+#include <vector>
+
+#include "entityStore.h"
+#include "spatialGrid.h"
+
+// tag::ArenaBounds[]
+//the walls of the play area - nothing's bounding box leaves it
+struct ArenaBounds
+{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+// end::ArenaBounds[]
+
+// tag::collisionFunctions[]
+//bounce entities in [begin, end) off the arena walls - entities are independent, so ranges can run in parallel
+//  - anything that went through a wall is mirrored back by the distance it overshot, which is exactly where it
+//    would be had we caught the moment of impact, so walls can't be tunnelled through however big the step
+void collideWithArena(EntityStore &entities, size_t begin, size_t end, const ArenaBounds &arena);
+
+//time of impact of box a moving by displacement, against a stationary box b
+//  - true if they first touch during the move, with timeOfImpact in [0,1] and the axis they touch across
+//  - false if they miss, or already overlap at the start (the narrowphase deals with those)
+bool sweptAabb(const glm::vec3 &aCentre, const glm::vec3 &aHalf, const glm::vec3 &displacement,
+               const glm::vec3 &bCentre, const glm::vec3 &bHalf, float &timeOfImpact, int &normalAxis);
+
+//continuous collision for balls against paddles, run before integrating with the same dt
+//  - pairs should come from a broadphase built with sweepTime = dt
+//  - each ball bounces off the first paddle it would hit this tick, at the moment it hits, and its position
+//    is adjusted so integrating over the whole of dt lands it where the bounce takes it
+//  - returns the number of balls that bounced
+size_t sweepBallsAgainstPaddles(EntityStore &entities, const std::vector<CollisionPair> &pairs, float dt);
+
+//narrowphase - separate and bounce each overlapping pair from the broadphase
+//  - paddles are immovable as far as balls are concerned; paddles never collide with each other
+//  - returns how many pairs were actually touching when we got to them
+size_t resolveCollisions(EntityStore &entities, const std::vector<CollisionPair> &pairs);
+// end::collisionFunctions[]
+
+#endif
@@ -0,0 +1,136 @@
+#include "dynamicResolution.h"
+#include "glState.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// tag::SceneTarget[]
+SceneTarget::SceneTarget()
+	: framebuffer(0), colorBuffer(0), depthBuffer(0), fullWidth(0), fullHeight(0), sceneWidth(0), sceneHeight(0), currentScale(1.0f)
+{
+}
+
+bool SceneTarget::initialise(int windowWidth, int windowHeight)
+{
+	fullWidth = std::max(windowWidth, 1);
+	fullHeight = std::max(windowHeight, 1);
+	if (!create())
+	{
+		std::cerr << "Scene framebuffer incomplete - drawing straight to the window, at full resolution" << std::endl;
+		destroy();
+		return false;
+	}
+	setScale(currentScale);
+	std::cout << "Scene target created OK! GLUint is: " << framebuffer << std::endl;
+	return true;
+}
+
+void SceneTarget::shutdown()
+{
+	destroy();
+}
+
+bool SceneTarget::create()
+{
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(1, &colorBuffer);
+	glGenRenderbuffers(1, &depthBuffer);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, fullWidth, fullHeight);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, fullWidth, fullHeight);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glState.bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	bool complete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+	return complete;
+}
+
+void SceneTarget::destroy()
+{
+	if (framebuffer != 0)
+		glState.deleteFramebuffers(1, &framebuffer);
+	if (colorBuffer != 0)
+		glDeleteRenderbuffers(1, &colorBuffer);
+	if (depthBuffer != 0)
+		glDeleteRenderbuffers(1, &depthBuffer);
+	framebuffer = colorBuffer = depthBuffer = 0;
+}
+
+void SceneTarget::resize(int windowWidth, int windowHeight)
+{
+	if (framebuffer == 0 || (windowWidth == fullWidth && windowHeight == fullHeight))
+		return;
+	destroy();
+	initialise(windowWidth, windowHeight);
+}
+
+void SceneTarget::setScale(float scale)
+{
+	currentScale = scale;
+	sceneWidth = std::max(1, (int)(fullWidth * scale + 0.5f));
+	sceneHeight = std::max(1, (int)(fullHeight * scale + 0.5f));
+}
+
+void SceneTarget::bind()
+{
+	glState.bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glState.viewport(0, 0, sceneWidth, sceneHeight);
+}
+
+void SceneTarget::present()
+{
+	glState.bindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glState.bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	GLenum filter = (sceneWidth == fullWidth && sceneHeight == fullHeight) ? GL_NEAREST : GL_LINEAR;
+	glBlitFramebuffer(0, 0, sceneWidth, sceneHeight, 0, 0, fullWidth, fullHeight, GL_COLOR_BUFFER_BIT, filter);
+}
+// end::SceneTarget[]
+
+// tag::ResolutionController[]
+ResolutionController::ResolutionController()
+	: budget(16.0f), minimumScale(0.5f), maximumScale(1.0f), currentScale(1.0f), smoothedMs(0.0f), framesSinceChange(0), changes(0)
+{
+}
+
+void ResolutionController::configure(float budgetMilliseconds, float minScale, float maxScale)
+{
+	budget = budgetMilliseconds;
+	minimumScale = minScale;
+	maximumScale = maxScale;
+	currentScale = std::min(std::max(currentScale, minimumScale), maximumScale);
+}
+
+float ResolutionController::update(float frameMilliseconds)
+{
+	const int settleFrames = 8; //wait this long after a change - longer than the GPU timer's latency
+	const float maxStep = 0.1f; //most the scale moves in one change
+	const float scaleUpBelow = 0.8f; //of the budget
+
+	if (frameMilliseconds <= 0.0f)
+		return currentScale; //no timing yet
+	smoothedMs = (smoothedMs == 0.0f) ? frameMilliseconds : smoothedMs * 0.9f + frameMilliseconds * 0.1f;
+
+	framesSinceChange++;
+	if (framesSinceChange < settleFrames)
+		return currentScale;
+	if (smoothedMs <= budget && smoothedMs >= budget * scaleUpBelow)
+		return currentScale; //close enough
+
+	float wanted = currentScale * sqrtf(budget / smoothedMs);
+	wanted = std::min(std::max(wanted, currentScale - maxStep), currentScale + maxStep);
+	wanted = std::min(std::max(wanted, minimumScale), maximumScale);
+	if (fabsf(wanted - currentScale) < 0.01f)
+		return currentScale;
+
+	currentScale = wanted;
+	framesSinceChange = 0;
+	changes++;
+	return currentScale;
+}
+// end::ResolutionController[]
@@ -0,0 +1,68 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <GL/glew.h>
+
+// tag::SceneTarget[]
+//an offscreen framebuffer the scene is drawn into, at a fraction of the window's size, and then stretched to fit it
+//  - the buffers are always the window's full size; a smaller scale just draws into the bottom-left corner of
+//    them, so changing the scale never reallocates anything - only a window resize does
+//  - present() blits the drawn corner to the default framebuffer with linear filtering
+class SceneTarget
+{
+public:
+	SceneTarget();
+
+	bool initialise(int windowWidth, int windowHeight); //needs a current GL context - false if the framebuffer isn't complete
+	void shutdown();
+	void resize(int windowWidth, int windowHeight);
+
+	void setScale(float scale); //fraction of the window's width and height
+	void bind(); //draw into the scene - binds the framebuffer and sets the viewport
+	void present(); //stretch the scene over the window
+
+	float scale() const { return currentScale; }
+	int width() const { return sceneWidth; }
+	int height() const { return sceneHeight; }
+
+private:
+	bool create();
+	void destroy();
+
+	GLuint framebuffer;
+	GLuint colorBuffer;
+	GLuint depthBuffer;
+	int fullWidth, fullHeight;
+	int sceneWidth, sceneHeight;
+	float currentScale;
+};
+// end::SceneTarget[]
+
+// tag::ResolutionController[]
+//picks the scene scale that keeps the frame time near a budget
+//  - the cost we can change is per pixel, so the frame time goes roughly with scale squared; the scale moves
+//    by the square root of budget / frame time, limited to a small step each time
+//  - frame times are smoothed, and after each change we wait a few frames (the GPU timings we're given are
+//    already a few frames old) so one slow frame doesn't make it hunt up and down
+//  - there's a dead band: it only scales up once frames are comfortably under budget
+class ResolutionController
+{
+public:
+	ResolutionController();
+
+	void configure(float budgetMilliseconds, float minScale, float maxScale);
+	float update(float frameMilliseconds); //once a frame - returns the scale to use next
+	float scale() const { return currentScale; }
+	int changeCount() const { return changes; }
+
+private:
+	float budget;
+	float minimumScale, maximumScale;
+	float currentScale;
+	float smoothedMs;
+	int framesSinceChange;
+	int changes;
+};
+// end::ResolutionController[]
+
+#endif
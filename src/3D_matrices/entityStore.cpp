@@ -0,0 +1,175 @@
+#include "entityStore.h"
+
+#include <cassert>
+#include <cstring>
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define ENTITY_STORE_AVX
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define ENTITY_STORE_SSE
+#endif
+
+// tag::create[]
+EntityHandle EntityStore::create(EntityKind entityKind, glm::vec3 position, glm::vec3 velocity, glm::vec3 halfExtents)
+{
+	uint32_t slot;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		slot = (uint32_t)slotToDense.size();
+		slotToDense.push_back(0);
+		slotGeneration.push_back(0);
+	}
+
+	slotToDense[slot] = (uint32_t)size();
+	denseToSlot.push_back(slot);
+
+	posX.push_back(position.x); posY.push_back(position.y); posZ.push_back(position.z);
+	velX.push_back(velocity.x); velY.push_back(velocity.y); velZ.push_back(velocity.z);
+	prevX.push_back(position.x); prevY.push_back(position.y); prevZ.push_back(position.z);
+	halfX.push_back(halfExtents.x); halfY.push_back(halfExtents.y); halfZ.push_back(halfExtents.z);
+	kind.push_back(entityKind);
+
+	EntityHandle handle = { slot, slotGeneration[slot] };
+	return handle;
+}
+// end::create[]
+
+// tag::destroy[]
+//swap-remove: move the last entity into the gap so the arrays stay dense
+void EntityStore::destroy(EntityHandle handle)
+{
+	if (!isAlive(handle))
+		return;
+
+	size_t index = slotToDense[handle.slot];
+	size_t last = size() - 1;
+
+	if (index != last)
+	{
+		posX[index] = posX[last]; posY[index] = posY[last]; posZ[index] = posZ[last];
+		velX[index] = velX[last]; velY[index] = velY[last]; velZ[index] = velZ[last];
+		prevX[index] = prevX[last]; prevY[index] = prevY[last]; prevZ[index] = prevZ[last];
+		halfX[index] = halfX[last]; halfY[index] = halfY[last]; halfZ[index] = halfZ[last];
+		kind[index] = kind[last];
+
+		denseToSlot[index] = denseToSlot[last];
+		slotToDense[denseToSlot[index]] = (uint32_t)index;
+	}
+
+	posX.pop_back(); posY.pop_back(); posZ.pop_back();
+	velX.pop_back(); velY.pop_back(); velZ.pop_back();
+	prevX.pop_back(); prevY.pop_back(); prevZ.pop_back();
+	halfX.pop_back(); halfY.pop_back(); halfZ.pop_back();
+	kind.pop_back();
+	denseToSlot.pop_back();
+
+	slotGeneration[handle.slot]++; //any other copies of this handle are now stale
+	freeSlots.push_back(handle.slot);
+}
+// end::destroy[]
+
+void EntityStore::clear()
+{
+	while (size() > 0)
+	{
+		EntityHandle handle = { denseToSlot.back(), slotGeneration[denseToSlot.back()] };
+		destroy(handle);
+	}
+}
+
+void EntityStore::reserve(size_t count)
+{
+	posX.reserve(count); posY.reserve(count); posZ.reserve(count);
+	velX.reserve(count); velY.reserve(count); velZ.reserve(count);
+	prevX.reserve(count); prevY.reserve(count); prevZ.reserve(count);
+	halfX.reserve(count); halfY.reserve(count); halfZ.reserve(count);
+	kind.reserve(count);
+	denseToSlot.reserve(count);
+}
+
+bool EntityStore::isAlive(EntityHandle handle) const
+{
+	return handle.slot < slotGeneration.size() && slotGeneration[handle.slot] == handle.generation;
+}
+
+size_t EntityStore::indexOf(EntityHandle handle) const
+{
+	assert(isAlive(handle));
+	return slotToDense[handle.slot];
+}
+
+glm::vec3 EntityStore::interpolatedPosition(size_t index, float alpha) const
+{
+	return glm::vec3(prevX[index] + (posX[index] - prevX[index]) * alpha,
+	                 prevY[index] + (posY[index] - prevY[index]) * alpha,
+	                 prevZ[index] + (posZ[index] - prevZ[index]) * alpha);
+}
+
+void EntityStore::savePrevious()
+{
+	if (size() == 0)
+		return;
+	memcpy(prevX.data(), posX.data(), size() * sizeof(float));
+	memcpy(prevY.data(), posY.data(), size() * sizeof(float));
+	memcpy(prevZ.data(), posZ.data(), size() * sizeof(float));
+}
+
+// tag::integrateAxis[]
+//position[i] += velocity[i] * dt over [begin, end) - full SIMD width in the middle, scalar at the ragged ends
+static void integrateAxis(float *position, const float *velocity, size_t begin, size_t end, float dt)
+{
+	size_t i = begin;
+
+#if defined(ENTITY_STORE_AVX)
+	for (; i < end && (i & 7) != 0; i++) //scalar until we reach a 32 byte boundary
+		position[i] += velocity[i] * dt;
+
+	const __m256 dt8 = _mm256_set1_ps(dt);
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 p = _mm256_load_ps(position + i);
+		__m256 v = _mm256_load_ps(velocity + i);
+		_mm256_store_ps(position + i, _mm256_add_ps(p, _mm256_mul_ps(v, dt8)));
+	}
+#elif defined(ENTITY_STORE_SSE)
+	for (; i < end && (i & 3) != 0; i++) //scalar until we reach a 16 byte boundary
+		position[i] += velocity[i] * dt;
+
+	const __m128 dt4 = _mm_set1_ps(dt);
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 p = _mm_load_ps(position + i);
+		__m128 v = _mm_load_ps(velocity + i);
+		_mm_store_ps(position + i, _mm_add_ps(p, _mm_mul_ps(v, dt4)));
+	}
+#endif
+
+	for (; i < end; i++)
+		position[i] += velocity[i] * dt;
+}
+// end::integrateAxis[]
+
+void EntityStore::integrateRange(size_t begin, size_t end, float dt)
+{
+	integrateAxis(posX.data(), velX.data(), begin, end, dt);
+	integrateAxis(posY.data(), velY.data(), begin, end, dt);
+	integrateAxis(posZ.data(), velZ.data(), begin, end, dt);
+}
+
+const char *simdInstructionSet()
+{
+#if defined(ENTITY_STORE_AVX)
+	return "AVX";
+#elif defined(ENTITY_STORE_SSE)
+	return "SSE";
+#else
+	return "scalar";
+#endif
+}
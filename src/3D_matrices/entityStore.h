@@ -0,0 +1,107 @@
+#ifndef ENTITY_STORE_H
+#define ENTITY_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+// tag::AlignedAllocator[]
+//allocator giving 32 byte aligned storage, so SIMD loads never straddle a cache line
+template <typename T, size_t Alignment = 32>
+struct AlignedAllocator
+{
+	typedef T value_type;
+
+	AlignedAllocator() {}
+	template <typename U> AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+	template <typename U> struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+	T *allocate(size_t count)
+	{
+		//over-allocate, and stash the pointer malloc gave us just before the aligned block
+		void *raw = std::malloc(count * sizeof(T) + Alignment + sizeof(void *));
+		if (raw == nullptr)
+			throw std::bad_alloc();
+		uintptr_t aligned = ((uintptr_t)raw + sizeof(void *) + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+		((void **)aligned)[-1] = raw;
+		return (T *)aligned;
+	}
+
+	void deallocate(T *pointer, size_t)
+	{
+		if (pointer != nullptr)
+			std::free(((void **)pointer)[-1]);
+	}
+};
+
+template <typename T, typename U, size_t A>
+bool operator==(const AlignedAllocator<T, A> &, const AlignedAllocator<U, A> &) { return true; }
+template <typename T, typename U, size_t A>
+bool operator!=(const AlignedAllocator<T, A> &, const AlignedAllocator<U, A> &) { return false; }
+
+typedef std::vector<float, AlignedAllocator<float> > FloatArray;
+// end::AlignedAllocator[]
+
+// tag::EntityHandle[]
+enum EntityKind : uint8_t
+{
+	ENTITY_PADDLE = 0,
+	ENTITY_BALL,
+};
+
+//a handle stays valid (and keeps referring to the same entity) while entities around it are
+//  created and destroyed - the generation catches use of a handle after its entity was destroyed
+struct EntityHandle
+{
+	uint32_t slot;
+	uint32_t generation;
+};
+// end::EntityHandle[]
+
+// tag::EntityStore[]
+//structure-of-arrays storage for everything that moves
+//  - each attribute is its own contiguous array, indexed by a dense index in [0, size())
+//  - dense indices change when entities are destroyed (the last entity is swapped into the gap),
+//    so hold on to EntityHandles, and look up the dense index when you need it
+class EntityStore
+{
+public:
+	EntityHandle create(EntityKind entityKind, glm::vec3 position, glm::vec3 velocity, glm::vec3 halfExtents);
+	void destroy(EntityHandle handle);
+	void clear();
+	void reserve(size_t count);
+
+	bool isAlive(EntityHandle handle) const;
+	size_t indexOf(EntityHandle handle) const; //dense index - only valid until the next destroy()
+	size_t size() const { return kind.size(); }
+
+	glm::vec3 position(size_t index) const { return glm::vec3(posX[index], posY[index], posZ[index]); }
+	glm::vec3 interpolatedPosition(size_t index, float alpha) const;
+
+	void savePrevious(); //copy positions into prev*, at the start of each tick
+	void integrate(float dt) { integrateRange(0, size(), dt); }
+	void integrateRange(size_t begin, size_t end, float dt); //pos += vel * dt, SIMD where available
+
+	//the SoA data - read and write freely, but only change the size through create/destroy
+	FloatArray posX, posY, posZ;
+	FloatArray velX, velY, velZ;
+	FloatArray prevX, prevY, prevZ;
+	FloatArray halfX, halfY, halfZ;
+	std::vector<EntityKind> kind;
+
+private:
+	std::vector<uint32_t> denseToSlot;
+	std::vector<uint32_t> slotToDense;
+	std::vector<uint32_t> slotGeneration;
+	std::vector<uint32_t> freeSlots;
+};
+
+const char *simdInstructionSet(); //which integrator was compiled in
+// end::EntityStore[]
+
+#endif
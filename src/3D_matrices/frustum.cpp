@@ -0,0 +1,157 @@
+#include "frustum.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define FRUSTUM_AVX
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define FRUSTUM_SSE
+#endif
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+// tag::extractFrustum[]
+Frustum extractFrustum(const glm::mat4 &viewProjection)
+{
+	//GLM is column major - m[column][row] - so row r is (m[0][r], m[1][r], m[2][r], m[3][r])
+	glm::vec4 row[4];
+	for (int r = 0; r < 4; r++)
+		row[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+
+	Frustum frustum;
+	frustum.planes[0] = row[3] + row[0]; //left
+	frustum.planes[1] = row[3] - row[0]; //right
+	frustum.planes[2] = row[3] + row[1]; //bottom
+	frustum.planes[3] = row[3] - row[1]; //top
+	frustum.planes[4] = row[3] + row[2]; //near
+	frustum.planes[5] = row[3] - row[2]; //far
+
+	//normalise, so dot(plane, p) is a distance we can compare a radius with
+	for (int i = 0; i < 6; i++)
+		frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+	return frustum;
+}
+// end::extractFrustum[]
+
+static inline int lowestBit(unsigned mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (int)index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// tag::cullKernel[]
+//one kernel for boxes and spheres: a box's "radius" towards a plane is how far it reaches along the plane's
+//normal, |nx| * halfX + |ny| * halfY + |nz| * halfZ; a sphere's is the same for every plane
+//  - visible unless, for some plane, distance(centre) < -radius
+template <bool Spheres>
+static size_t cullKernel(const Frustum &frustum, const float *x, const float *y, const float *z,
+                         const float *halfX, const float *halfY, const float *halfZ, size_t count, uint32_t *visible)
+{
+	size_t visibleCount = 0;
+	size_t i = 0;
+
+#if defined(FRUSTUM_AVX)
+	__m256 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; p++)
+	{
+		const glm::vec4 &plane = frustum.planes[p];
+		planeX[p] = _mm256_set1_ps(plane.x); absX[p] = _mm256_set1_ps(std::fabs(plane.x));
+		planeY[p] = _mm256_set1_ps(plane.y); absY[p] = _mm256_set1_ps(std::fabs(plane.y));
+		planeZ[p] = _mm256_set1_ps(plane.z); absZ[p] = _mm256_set1_ps(std::fabs(plane.z));
+		planeW[p] = _mm256_set1_ps(plane.w);
+	}
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 cx = _mm256_loadu_ps(x + i), cy = _mm256_loadu_ps(y + i), cz = _mm256_loadu_ps(z + i);
+		__m256 hx = _mm256_loadu_ps(halfX + i);
+		__m256 hy = Spheres ? hx : _mm256_loadu_ps(halfY + i);
+		__m256 hz = Spheres ? hx : _mm256_loadu_ps(halfZ + i);
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy)),
+			                                _mm256_add_ps(_mm256_mul_ps(planeZ[p], cz), planeW[p]));
+			__m256 reach = Spheres ? hx : _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absX[p], hx), _mm256_mul_ps(absY[p], hy)),
+			                                            _mm256_mul_ps(absZ[p], hz));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+		unsigned mask = (unsigned)_mm256_movemask_ps(inside);
+		while (mask != 0) //write out the set lanes, in order
+		{
+			visible[visibleCount++] = (uint32_t)(i + lowestBit(mask));
+			mask &= mask - 1;
+		}
+	}
+#elif defined(FRUSTUM_SSE)
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; p++)
+	{
+		const glm::vec4 &plane = frustum.planes[p];
+		planeX[p] = _mm_set1_ps(plane.x); absX[p] = _mm_set1_ps(std::fabs(plane.x));
+		planeY[p] = _mm_set1_ps(plane.y); absY[p] = _mm_set1_ps(std::fabs(plane.y));
+		planeZ[p] = _mm_set1_ps(plane.z); absZ[p] = _mm_set1_ps(std::fabs(plane.z));
+		planeW[p] = _mm_set1_ps(plane.w);
+	}
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 cx = _mm_loadu_ps(x + i), cy = _mm_loadu_ps(y + i), cz = _mm_loadu_ps(z + i);
+		__m128 hx = _mm_loadu_ps(halfX + i);
+		__m128 hy = Spheres ? hx : _mm_loadu_ps(halfY + i);
+		__m128 hz = Spheres ? hx : _mm_loadu_ps(halfZ + i);
+		__m128 inside = _mm_cmpeq_ps(hx, hx); //all ones (radii are never NaN)
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+			                             _mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+			__m128 reach = Spheres ? hx : _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], hx), _mm_mul_ps(absY[p], hy)),
+			                                         _mm_mul_ps(absZ[p], hz));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+		}
+		unsigned mask = (unsigned)_mm_movemask_ps(inside);
+		while (mask != 0) //write out the set lanes, in order
+		{
+			visible[visibleCount++] = (uint32_t)(i + lowestBit(mask));
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++)
+		{
+			const glm::vec4 &plane = frustum.planes[p];
+			float distance = plane.x * x[i] + plane.y * y[i] + plane.z * z[i] + plane.w;
+			float reach = Spheres ? halfX[i] : std::fabs(plane.x) * halfX[i] + std::fabs(plane.y) * halfY[i] + std::fabs(plane.z) * halfZ[i];
+			inside = (distance + reach >= 0.0f);
+		}
+		if (inside)
+			visible[visibleCount++] = (uint32_t)i;
+	}
+	return visibleCount;
+}
+// end::cullKernel[]
+
+size_t cullBoxes(const Frustum &frustum, const float *x, const float *y, const float *z,
+                 const float *halfX, const float *halfY, const float *halfZ, size_t count, uint32_t *visible)
+{
+	return cullKernel<false>(frustum, x, y, z, halfX, halfY, halfZ, count, visible);
+}
+
+size_t cullSpheres(const Frustum &frustum, const float *x, const float *y, const float *z,
+                   const float *radius, size_t count, uint32_t *visible)
+{
+	return cullKernel<true>(frustum, x, y, z, radius, radius, radius, count, visible);
+}
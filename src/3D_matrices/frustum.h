@@ -0,0 +1,36 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+// tag::Frustum[]
+//the six planes of what the camera can see, pointing inwards: a point p is inside a plane when
+//dot(plane.xyz, p) + plane.w >= 0
+struct Frustum
+{
+	glm::vec4 planes[6]; //left, right, bottom, top, near, far
+};
+
+//Gribb-Hartmann: each plane is a sum or difference of rows of projection * view
+Frustum extractFrustum(const glm::mat4 &viewProjection);
+// end::Frustum[]
+
+// tag::cullBoxes[]
+//axis-aligned boxes, as structure-of-arrays (centre and half extents), tested against the frustum
+//  - 8 boxes at a time with AVX, 4 with SSE, one at a time otherwise
+//  - visible gets the indices of every box at least partly inside, in order - room for count entries
+//  - returns how many are visible
+//  - conservative: a box near a corner, outside two planes but inside each one alone, counts as visible
+size_t cullBoxes(const Frustum &frustum, const float *x, const float *y, const float *z,
+                 const float *halfX, const float *halfY, const float *halfZ, size_t count, uint32_t *visible);
+
+//the same for spheres
+size_t cullSpheres(const Frustum &frustum, const float *x, const float *y, const float *z,
+                   const float *radius, size_t count, uint32_t *visible);
+// end::cullBoxes[]
+
+#endif
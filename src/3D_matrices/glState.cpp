@@ -0,0 +1,301 @@
+#include "glState.h"
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+GLState glState;
+
+const char *glStateCallName(GLStateCall call)
+{
+	switch (call)
+	{
+	case GL_STATE_PROGRAM: return "program";
+	case GL_STATE_VERTEX_ARRAY: return "vertex array";
+	case GL_STATE_BUFFER: return "buffer";
+	case GL_STATE_FRAMEBUFFER: return "framebuffer";
+	case GL_STATE_ENABLE: return "enable/disable";
+	case GL_STATE_VIEWPORT: return "viewport";
+	case GL_STATE_CLEAR_VALUES: return "clear values";
+	case GL_STATE_UNIFORM: return "uniform";
+	default: return "unknown";
+	}
+}
+
+GLState::GLState()
+{
+	const GLenum targets[trackedBufferTargets] = {
+		GL_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+		GL_PIXEL_PACK_BUFFER, GL_PIXEL_UNPACK_BUFFER, GL_TEXTURE_BUFFER, GL_TRANSFORM_FEEDBACK_BUFFER,
+		GL_DRAW_INDIRECT_BUFFER
+	};
+	for (int i = 0; i < trackedBufferTargets; i++)
+		bufferTargets[i] = targets[i];
+	for (int i = 0; i < GL_STATE_CALL_COUNT; i++)
+		made[i] = saved[i] = 0;
+	invalidate();
+}
+
+void GLState::invalidate()
+{
+	program = 0;
+	programKnown = false;
+	vertexArray = 0;
+	vertexArrayKnown = false;
+	for (int i = 0; i < trackedBufferTargets; i++)
+	{
+		buffers[i] = 0;
+		buffersKnown[i] = false;
+	}
+	drawFramebuffer = readFramebuffer = 0;
+	drawFramebufferKnown = readFramebufferKnown = false;
+	enabled.clear();
+	viewportKnown = false;
+	clearColorKnown = false;
+	clearDepthKnown = false;
+	uniforms.clear();
+}
+
+int GLState::bufferTargetIndex(GLenum target) const
+{
+	for (int i = 0; i < trackedBufferTargets; i++)
+		if (bufferTargets[i] == target)
+			return i;
+	return -1;
+}
+
+// tag::bindings[]
+void GLState::useProgram(GLuint newProgram)
+{
+	if (count(GL_STATE_PROGRAM, !programKnown || program != newProgram))
+	{
+		glUseProgram(newProgram);
+		program = newProgram;
+		programKnown = true;
+	}
+}
+
+void GLState::bindVertexArray(GLuint newVertexArray)
+{
+	if (count(GL_STATE_VERTEX_ARRAY, !vertexArrayKnown || vertexArray != newVertexArray))
+	{
+		glBindVertexArray(newVertexArray);
+		vertexArray = newVertexArray;
+		vertexArrayKnown = true;
+	}
+}
+
+void GLState::bindBuffer(GLenum target, GLuint buffer)
+{
+	int index = bufferTargetIndex(target);
+	if (index < 0)
+	{
+		count(GL_STATE_BUFFER, true);
+		glBindBuffer(target, buffer);
+		return;
+	}
+	if (count(GL_STATE_BUFFER, !buffersKnown[index] || buffers[index] != buffer))
+	{
+		glBindBuffer(target, buffer);
+		buffers[index] = buffer;
+		buffersKnown[index] = true;
+	}
+}
+
+void GLState::bindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	bool draw = (target != GL_READ_FRAMEBUFFER);
+	bool read = (target != GL_DRAW_FRAMEBUFFER);
+	bool changed = (draw && (!drawFramebufferKnown || drawFramebuffer != framebuffer))
+	            || (read && (!readFramebufferKnown || readFramebuffer != framebuffer));
+	if (count(GL_STATE_FRAMEBUFFER, changed))
+	{
+		glBindFramebuffer(target, framebuffer);
+		if (draw)
+		{
+			drawFramebuffer = framebuffer;
+			drawFramebufferKnown = true;
+		}
+		if (read)
+		{
+			readFramebuffer = framebuffer;
+			readFramebufferKnown = true;
+		}
+	}
+}
+// end::bindings[]
+
+void GLState::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	//indexed bindings aren't cached, but this changes the generic binding too
+	count(GL_STATE_BUFFER, true);
+	glBindBufferBase(target, index, buffer);
+	int targetIndex = bufferTargetIndex(target);
+	if (targetIndex >= 0)
+	{
+		buffers[targetIndex] = buffer;
+		buffersKnown[targetIndex] = true;
+	}
+}
+
+void GLState::enable(GLenum capability)
+{
+	std::map<GLenum, bool>::iterator found = enabled.find(capability);
+	if (count(GL_STATE_ENABLE, found == enabled.end() || !found->second))
+	{
+		glEnable(capability);
+		enabled[capability] = true;
+	}
+}
+
+void GLState::disable(GLenum capability)
+{
+	std::map<GLenum, bool>::iterator found = enabled.find(capability);
+	if (count(GL_STATE_ENABLE, found == enabled.end() || found->second))
+	{
+		glDisable(capability);
+		enabled[capability] = false;
+	}
+}
+
+void GLState::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	GLint value[4] = { x, y, width, height };
+	if (count(GL_STATE_VIEWPORT, !viewportKnown || memcmp(value, viewportValue, sizeof(value)) != 0))
+	{
+		glViewport(x, y, width, height);
+		memcpy(viewportValue, value, sizeof(value));
+		viewportKnown = true;
+	}
+}
+
+void GLState::clearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+	GLfloat value[4] = { r, g, b, a };
+	if (count(GL_STATE_CLEAR_VALUES, !clearColorKnown || memcmp(value, clearColorValue, sizeof(value)) != 0))
+	{
+		glClearColor(r, g, b, a);
+		memcpy(clearColorValue, value, sizeof(value));
+		clearColorKnown = true;
+	}
+}
+
+void GLState::clearDepth(GLdouble depth)
+{
+	if (count(GL_STATE_CLEAR_VALUES, !clearDepthKnown || clearDepthValue != depth))
+	{
+		glClearDepth(depth);
+		clearDepthValue = depth;
+		clearDepthKnown = true;
+	}
+}
+
+// tag::uniforms[]
+bool GLState::setUniform(GLint location, const void *value, size_t bytes)
+{
+	if (location < 0)
+		return false; //not in this program - GL would ignore it too
+	if (!programKnown)
+		return count(GL_STATE_UNIFORM, true); //we don't know which program these belong to
+
+	UniformValue &cached = uniforms[std::make_pair(program, location)];
+	bool changed = (cached.size != bytes || memcmp(cached.bytes, value, bytes) != 0);
+	if (changed)
+	{
+		memcpy(cached.bytes, value, bytes);
+		cached.size = bytes;
+	}
+	return count(GL_STATE_UNIFORM, changed);
+}
+
+void GLState::uniform1i(GLint location, GLint value)
+{
+	if (setUniform(location, &value, sizeof(value)))
+		glUniform1i(location, value);
+}
+
+void GLState::uniform1f(GLint location, GLfloat value)
+{
+	if (setUniform(location, &value, sizeof(value)))
+		glUniform1f(location, value);
+}
+
+void GLState::uniform4fv(GLint location, const GLfloat *value)
+{
+	if (setUniform(location, value, 4 * sizeof(GLfloat)))
+		glUniform4fv(location, 1, value);
+}
+
+void GLState::uniformMatrix4fv(GLint location, const GLfloat *value)
+{
+	if (setUniform(location, value, 16 * sizeof(GLfloat)))
+		glUniformMatrix4fv(location, 1, GL_FALSE, value);
+}
+// end::uniforms[]
+
+void GLState::deleteProgram(GLuint deletedProgram)
+{
+	glDeleteProgram(deletedProgram);
+	if (programKnown && program == deletedProgram)
+		programKnown = false; //GL keeps using it until something else is bound, but the name may come back
+	std::map<std::pair<GLuint, GLint>, UniformValue>::iterator it = uniforms.lower_bound(std::make_pair(deletedProgram, -1));
+	while (it != uniforms.end() && it->first.first == deletedProgram)
+		uniforms.erase(it++);
+}
+
+void GLState::deleteVertexArrays(GLsizei n, const GLuint *vertexArrays)
+{
+	glDeleteVertexArrays(n, vertexArrays);
+	for (GLsizei i = 0; i < n; i++)
+		if (vertexArray == vertexArrays[i])
+			vertexArray = 0; //deleting the bound vertex array binds 0
+}
+
+void GLState::deleteBuffers(GLsizei n, const GLuint *deletedBuffers)
+{
+	glDeleteBuffers(n, deletedBuffers);
+	for (GLsizei i = 0; i < n; i++)
+		for (int t = 0; t < trackedBufferTargets; t++)
+			if (buffers[t] == deletedBuffers[i])
+				buffers[t] = 0; //deleting a bound buffer binds 0
+}
+
+
+void GLState::deleteFramebuffers(GLsizei n, const GLuint *framebuffers)
+{
+	glDeleteFramebuffers(n, framebuffers);
+	for (GLsizei i = 0; i < n; i++)
+	{
+		//deleting a bound framebuffer binds the default one
+		if (drawFramebuffer == framebuffers[i])
+			drawFramebuffer = 0;
+		if (readFramebuffer == framebuffers[i])
+			readFramebuffer = 0;
+	}
+}
+
+// tag::printSummary[]
+void GLState::printSummary() const
+{
+	long long totalMade = 0, totalSaved = 0;
+	for (int i = 0; i < GL_STATE_CALL_COUNT; i++)
+	{
+		totalMade += made[i];
+		totalSaved += saved[i];
+	}
+	if (totalMade + totalSaved == 0)
+		return;
+
+	std::cout << "GL state changes (made / skipped as redundant):" << std::endl;
+	for (int i = 0; i < GL_STATE_CALL_COUNT; i++)
+	{
+		if (made[i] + saved[i] == 0)
+			continue;
+		std::cout << "  " << std::left << std::setw(16) << glStateCallName((GLStateCall)i) << std::right
+		          << made[i] << " / " << saved[i] << std::endl;
+	}
+	std::cout << "  " << std::left << std::setw(16) << "total" << std::right << totalMade << " / " << totalSaved
+	          << " (" << std::fixed << std::setprecision(1) << 100.0 * totalSaved / (totalMade + totalSaved) << "% skipped)"
+	          << std::defaultfloat << std::setprecision(6) << std::endl;
+}
+// end::printSummary[]
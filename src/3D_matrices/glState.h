@@ -0,0 +1,107 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <cstddef>
+#include <map>
+#include <utility>
+
+#include <GL/glew.h>
+
+// tag::GLStateCounter[]
+//the kinds of call the state cache counts separately
+enum GLStateCall
+{
+	GL_STATE_PROGRAM = 0,
+	GL_STATE_VERTEX_ARRAY,
+	GL_STATE_BUFFER,
+	GL_STATE_FRAMEBUFFER,
+	GL_STATE_ENABLE,
+	GL_STATE_VIEWPORT,
+	GL_STATE_CLEAR_VALUES,
+	GL_STATE_UNIFORM,
+	GL_STATE_CALL_COUNT
+};
+
+const char *glStateCallName(GLStateCall call);
+// end::GLStateCounter[]
+
+// tag::GLState[]
+//remembers what we last told GL, and skips calls that wouldn't change anything
+//  - every driver call costs CPU time (validation, and often a lock) even when it changes nothing
+//  - only works if all changes to the state it tracks go through it; if something else changes GL
+//    state behind its back, call invalidate() so it stops trusting what it remembers
+//  - GL_ELEMENT_ARRAY_BUFFER isn't tracked - it belongs to the bound vertex array, not the context
+//  - uniform values are remembered per program, so switching programs doesn't lose them
+class GLState
+{
+public:
+	GLState();
+
+	void invalidate(); //forget everything - the next call of each kind always goes to GL
+
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vertexArray);
+	void bindBuffer(GLenum target, GLuint buffer); //GL_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_COPY_*_BUFFER, ...
+	void bindBufferBase(GLenum target, GLuint index, GLuint buffer); //also binds to the generic target, like GL does
+	void bindFramebuffer(GLenum target, GLuint framebuffer); //GL_FRAMEBUFFER sets both the draw and read bindings
+	void enable(GLenum capability);
+	void disable(GLenum capability);
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+	void clearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+	void clearDepth(GLdouble depth);
+
+	//set on the current program
+	void uniform1i(GLint location, GLint value);
+	void uniform1f(GLint location, GLfloat value);
+	void uniform4fv(GLint location, const GLfloat *value);
+	void uniformMatrix4fv(GLint location, const GLfloat *value);
+
+	//deleting an object unbinds it, and its name may be reused - keep the cache in step
+	void deleteProgram(GLuint program);
+	void deleteVertexArrays(GLsizei count, const GLuint *vertexArrays);
+	void deleteBuffers(GLsizei count, const GLuint *buffers);
+	void deleteFramebuffers(GLsizei count, const GLuint *framebuffers);
+
+	long long callsMade(GLStateCall call) const { return made[call]; }
+	long long callsSaved(GLStateCall call) const { return saved[call]; }
+	void printSummary() const;
+
+private:
+	static const int trackedBufferTargets = 9;
+	int bufferTargetIndex(GLenum target) const; //-1 if we don't track it
+	bool setUniform(GLint location, const void *value, size_t bytes); //true if the value changed
+	bool count(GLStateCall call, bool changed) { (changed ? made : saved)[call]++; return changed; }
+
+	struct UniformValue
+	{
+		unsigned char bytes[64]; //a mat4 at most
+		size_t size;
+	};
+
+	//each value is only trusted once it has been set through us since the last invalidate()
+	GLuint program;
+	bool programKnown;
+	GLuint vertexArray;
+	bool vertexArrayKnown;
+	GLenum bufferTargets[trackedBufferTargets];
+	GLuint buffers[trackedBufferTargets];
+	bool buffersKnown[trackedBufferTargets];
+	GLuint drawFramebuffer, readFramebuffer;
+	bool drawFramebufferKnown, readFramebufferKnown;
+	std::map<GLenum, bool> enabled; //capabilities we know the value of
+	GLint viewportValue[4];
+	bool viewportKnown;
+	GLfloat clearColorValue[4];
+	bool clearColorKnown;
+	GLdouble clearDepthValue;
+	bool clearDepthKnown;
+	std::map<std::pair<GLuint, GLint>, UniformValue> uniforms; //by (program, location)
+
+	long long made[GL_STATE_CALL_COUNT];
+	long long saved[GL_STATE_CALL_COUNT];
+};
+
+extern GLState glState; //there is one GL context, so there is one of these
+// end::GLState[]
+
+#endif
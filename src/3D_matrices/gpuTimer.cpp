@@ -0,0 +1,207 @@
+#include "gpuTimer.h"
+
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+const char *gpuPassName(GpuPass pass)
+{
+	switch (pass)
+	{
+	case GPU_PASS_CLEAR: return "clear";
+	case GPU_PASS_OBJECTS: return "objects";
+	case GPU_PASS_UPSCALE: return "upscale";
+	default: return "unknown";
+	}
+}
+
+GpuTimer::GpuTimer()
+	: available(false), frameNumber(0), oldestPending(0), activePass(-1), samplesTotal(0), droppedFrames(0)
+{
+}
+
+// tag::initialise[]
+bool GpuTimer::initialise()
+{
+	//timer queries are core in OpenGL 3.3 - Mesa's llvmpipe and softpipe support them too
+	if (!GLEW_VERSION_3_3 && !GLEW_ARB_timer_query)
+	{
+		std::cout << "GPU timing disabled - timer queries are not supported\n";
+		return false;
+	}
+
+	GLint timestampBits = 0;
+	glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &timestampBits);
+	if (timestampBits == 0)
+	{
+		std::cout << "GPU timing disabled - the driver's timestamp counter has no bits\n";
+		return false;
+	}
+
+	for (int f = 0; f < framesInFlight; f++)
+	{
+		glGenQueries(GPU_PASS_COUNT, frames[f].passQueries);
+		glGenQueries(1, &frames[f].frameStart);
+		glGenQueries(1, &frames[f].frameEnd);
+		frames[f].pending = false;
+	}
+	available = true;
+	std::cout << "GPU timer queries created OK! (" << timestampBits << " bit timestamps)\n";
+	return true;
+}
+
+void GpuTimer::shutdown()
+{
+	if (!available)
+		return;
+	for (int f = 0; f < framesInFlight; f++)
+	{
+		glDeleteQueries(GPU_PASS_COUNT, frames[f].passQueries);
+		glDeleteQueries(1, &frames[f].frameStart);
+		glDeleteQueries(1, &frames[f].frameEnd);
+	}
+	available = false;
+}
+// end::initialise[]
+
+// tag::frame[]
+void GpuTimer::beginFrame()
+{
+	if (!available)
+		return;
+
+	collect();
+
+	//the oldest frame still hasn't finished, and we need its queries back - give up on it rather than wait
+	if (frameNumber - oldestPending >= framesInFlight)
+	{
+		frames[oldestPending % framesInFlight].pending = false;
+		oldestPending++;
+		droppedFrames++;
+	}
+
+	FrameQueries &frame = frames[frameNumber % framesInFlight];
+	for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+		frame.passUsed[pass] = false;
+	glQueryCounter(frame.frameStart, GL_TIMESTAMP);
+}
+
+void GpuTimer::endFrame()
+{
+	if (!available)
+		return;
+
+	FrameQueries &frame = frames[frameNumber % framesInFlight];
+	glQueryCounter(frame.frameEnd, GL_TIMESTAMP);
+	frame.pending = true;
+	frameNumber++;
+}
+
+void GpuTimer::beginPass(GpuPass pass)
+{
+	if (!available || activePass != -1)
+		return;
+	FrameQueries &frame = frames[frameNumber % framesInFlight];
+	glBeginQuery(GL_TIME_ELAPSED, frame.passQueries[pass]);
+	frame.passUsed[pass] = true;
+	activePass = pass;
+}
+
+void GpuTimer::endPass()
+{
+	if (!available || activePass == -1)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	activePass = -1;
+}
+// end::frame[]
+
+// tag::collect[]
+//read back finished frames, oldest first - stop at the first one that isn't ready
+void GpuTimer::collect()
+{
+	while (oldestPending < frameNumber)
+	{
+		FrameQueries &frame = frames[oldestPending % framesInFlight];
+		if (frame.pending && !collectFrame(frame))
+			break;
+		frame.pending = false;
+		oldestPending++;
+	}
+}
+
+bool GpuTimer::collectFrame(FrameQueries &frame)
+{
+	//queries finish in order, so if the end-of-frame timestamp is ready, everything before it is too
+	GLint ready = 0;
+	glGetQueryObjectiv(frame.frameEnd, GL_QUERY_RESULT_AVAILABLE, &ready);
+	if (!ready)
+		return false;
+
+	GLuint64 start = 0;
+	GLuint64 end = 0;
+	glGetQueryObjectui64v(frame.frameStart, GL_QUERY_RESULT, &start);
+	glGetQueryObjectui64v(frame.frameEnd, GL_QUERY_RESULT, &end);
+
+	size_t slot = samplesTotal % historySize;
+	for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+	{
+		GLuint64 elapsed = 0;
+		if (frame.passUsed[pass])
+			glGetQueryObjectui64v(frame.passQueries[pass], GL_QUERY_RESULT, &elapsed);
+		//a pass can't take longer than its frame - llvmpipe's very first GL_TIME_ELAPSED comes back as a raw timestamp
+		if (elapsed > end - start)
+			elapsed = end - start;
+		passSamples[pass][slot] = (float)(elapsed * 1e-6);
+	}
+	frameSamples[slot] = (float)((end - start) * 1e-6);
+
+	samplesTotal++;
+	return true;
+}
+// end::collect[]
+
+float GpuTimer::latestFrameMilliseconds() const
+{
+	return (samplesTotal > 0) ? frameSamples[(samplesTotal - 1) % historySize] : 0.0f;
+}
+
+static SampleSummary summariseRing(const float *ring, size_t total, size_t historySize)
+{
+	size_t count = (total < historySize) ? total : historySize;
+	std::vector<double> values(ring, ring + count);
+	return summariseSamples(values);
+}
+
+SampleSummary GpuTimer::summary(GpuPass pass) const
+{
+	return summariseRing(passSamples[pass], samplesTotal, historySize);
+}
+
+SampleSummary GpuTimer::frameSummary() const
+{
+	return summariseRing(frameSamples, samplesTotal, historySize);
+}
+
+// tag::printSummary[]
+void GpuTimer::printSummary() const
+{
+	if (!available)
+		return;
+
+	std::cout << "GPU timings over the last " << ((samplesTotal < historySize) ? samplesTotal : historySize) << " frames (ms)";
+	if (droppedFrames > 0)
+		std::cout << ", " << droppedFrames << " frames dropped as results weren't ready in time";
+	std::cout << ":\n";
+	std::cout << std::fixed << std::setprecision(3);
+	for (int pass = 0; pass <= GPU_PASS_COUNT; pass++)
+	{
+		bool isFrame = (pass == GPU_PASS_COUNT);
+		SampleSummary stats = isFrame ? frameSummary() : summary((GpuPass)pass);
+		std::cout << std::left << std::setw(12) << (isFrame ? "gpu frame" : gpuPassName((GpuPass)pass)) << std::right
+		          << std::setw(9) << stats.min << std::setw(9) << stats.mean << std::setw(9) << stats.p50
+		          << std::setw(9) << stats.p95 << std::setw(9) << stats.p99 << std::setw(9) << stats.max << "\n";
+	}
+	std::cout << std::defaultfloat << std::setprecision(6);
+}
+// end::printSummary[]
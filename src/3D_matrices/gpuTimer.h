@@ -0,0 +1,91 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <cstddef>
+
+#include <GL/glew.h>
+
+#include "timing.h"
+
+// tag::GpuPass[]
+//the GPU work we time separately
+enum GpuPass
+{
+	GPU_PASS_CLEAR = 0, //preRender()
+	GPU_PASS_OBJECTS,   //render() - every paddle and ball
+	GPU_PASS_UPSCALE,   //presentScene() - the scene target blitted to the window
+	GPU_PASS_COUNT
+};
+
+const char *gpuPassName(GpuPass pass);
+// end::GpuPass[]
+
+// tag::GpuTimer[]
+//GPU time per pass, and per frame, from timer queries
+//  - the GPU runs behind the CPU, so results are collected framesInFlight frames later, and only once
+//    GL_QUERY_RESULT_AVAILABLE says so - we never wait on a result, which would stall the pipeline
+//  - each pass is bracketed with GL_TIME_ELAPSED; the whole frame with a pair of GL_TIMESTAMPs
+//  - if a frame's results still aren't ready when its queries are needed again, that frame is dropped
+class GpuTimer
+{
+public:
+	static const int framesInFlight = 4;
+	static const size_t historySize = 1024;
+
+	GpuTimer();
+
+	bool initialise(); //needs a current GL context - false (and timing disabled) if timer queries aren't supported
+	void shutdown();
+	bool enabled() const { return available; }
+
+	void beginFrame(); //collects whatever older frames have finished, then starts this one
+	void endFrame();
+	void beginPass(GpuPass pass); //passes can't overlap
+	void endPass();
+
+	SampleSummary summary(GpuPass pass) const; //in milliseconds
+	SampleSummary frameSummary() const;
+	float latestFrameMilliseconds() const; //newest frame collected - a few frames old; 0 before the first
+	void printSummary() const;
+
+private:
+	struct FrameQueries
+	{
+		GLuint passQueries[GPU_PASS_COUNT];
+		GLuint frameStart;
+		GLuint frameEnd;
+		bool passUsed[GPU_PASS_COUNT];
+		bool pending;
+	};
+
+	void collect();
+	bool collectFrame(FrameQueries &frame); //false if its results aren't ready yet
+
+	bool available;
+	FrameQueries frames[framesInFlight];
+	long long frameNumber; //frames started
+	long long oldestPending;
+	int activePass;
+
+	float passSamples[GPU_PASS_COUNT][historySize]; //milliseconds, ring buffers
+	float frameSamples[historySize];
+	size_t samplesTotal;
+	size_t droppedFrames;
+};
+
+//times the GPU work issued in the enclosing scope
+class ScopedGpuPass
+{
+public:
+	ScopedGpuPass(GpuTimer &timer, GpuPass pass) : timer(timer) { timer.beginPass(pass); }
+	~ScopedGpuPass() { timer.endPass(); }
+
+private:
+	ScopedGpuPass(const ScopedGpuPass &);
+	ScopedGpuPass &operator=(const ScopedGpuPass &);
+
+	GpuTimer &timer;
+};
+// end::GpuTimer[]
+
+#endif
@@ -0,0 +1,285 @@
+#include "inputLog.h"
+
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+static const char logMagic[8] = { 'P', 'O', 'N', 'G', 'L', 'O', 'G', '1' };
+static const uint32_t logVersion = 1;
+
+// tag::stateChecksum[]
+static void hashFloats(uint32_t &hash, const FloatArray &values)
+{
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		uint32_t bits;
+		memcpy(&bits, &values[i], sizeof(bits));
+		hash = (hash ^ bits) * 16777619u;
+	}
+}
+
+uint32_t stateChecksum(const EntityStore &entities)
+{
+	uint32_t hash = 2166136261u;
+	hashFloats(hash, entities.posX); hashFloats(hash, entities.posY); hashFloats(hash, entities.posZ);
+	hashFloats(hash, entities.velX); hashFloats(hash, entities.velY); hashFloats(hash, entities.velZ);
+	return hash;
+}
+// end::stateChecksum[]
+
+// tag::stateSerialisation[]
+template <typename T>
+static void appendValue(std::vector<char> &buffer, const T &value)
+{
+	const char *bytes = (const char *)&value;
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+static bool readValue(const char *&cursor, const char *end, T &value)
+{
+	if ((size_t)(end - cursor) < sizeof(T))
+		return false;
+	memcpy(&value, cursor, sizeof(T));
+	cursor += sizeof(T);
+	return true;
+}
+
+static void appendFloats(std::vector<char> &buffer, const FloatArray &values)
+{
+	const char *bytes = (const char *)values.data();
+	buffer.insert(buffer.end(), bytes, bytes + values.size() * sizeof(float));
+}
+
+static bool readFloats(const char *&cursor, const char *end, FloatArray &values)
+{
+	size_t bytes = values.size() * sizeof(float);
+	if ((size_t)(end - cursor) < bytes)
+		return false;
+	if (bytes > 0)
+		memcpy(values.data(), cursor, bytes);
+	cursor += bytes;
+	return true;
+}
+
+static std::vector<char> captureState(const EntityStore &entities, const ArenaBounds &arena)
+{
+	std::vector<char> state;
+	appendValue(state, (uint32_t)entities.size());
+	for (int axis = 0; axis < 3; axis++)
+		appendValue(state, arena.min[axis]);
+	for (int axis = 0; axis < 3; axis++)
+		appendValue(state, arena.max[axis]);
+
+	appendFloats(state, entities.posX); appendFloats(state, entities.posY); appendFloats(state, entities.posZ);
+	appendFloats(state, entities.velX); appendFloats(state, entities.velY); appendFloats(state, entities.velZ);
+	appendFloats(state, entities.prevX); appendFloats(state, entities.prevY); appendFloats(state, entities.prevZ);
+	appendFloats(state, entities.halfX); appendFloats(state, entities.halfY); appendFloats(state, entities.halfZ);
+	state.insert(state.end(), (const char *)entities.kind.data(), (const char *)entities.kind.data() + entities.size());
+	return state;
+}
+
+//the size of a state block starting at cursor, or 0 if it is truncated
+static size_t stateSize(const char *cursor, const char *end)
+{
+	uint32_t entityCount;
+	if (!readValue(cursor, end, entityCount))
+		return 0;
+	size_t size = sizeof(uint32_t) + 6 * sizeof(float) + (size_t)entityCount * (12 * sizeof(float) + 1);
+	return (size <= (size_t)(end - cursor) + sizeof(uint32_t)) ? size : 0;
+}
+
+bool restoreState(const std::vector<char> &state, EntityStore &entities, ArenaBounds &arena)
+{
+	const char *cursor = state.data();
+	const char *end = cursor + state.size();
+
+	uint32_t entityCount;
+	if (!readValue(cursor, end, entityCount) || entityCount != entities.size())
+	{
+		std::cerr << "Saved state doesn't match the game - it has a different number of entities" << std::endl;
+		return false;
+	}
+	for (int axis = 0; axis < 3; axis++)
+		readValue(cursor, end, arena.min[axis]);
+	for (int axis = 0; axis < 3; axis++)
+		readValue(cursor, end, arena.max[axis]);
+
+	bool ok = readFloats(cursor, end, entities.posX) && readFloats(cursor, end, entities.posY) && readFloats(cursor, end, entities.posZ)
+	       && readFloats(cursor, end, entities.velX) && readFloats(cursor, end, entities.velY) && readFloats(cursor, end, entities.velZ)
+	       && readFloats(cursor, end, entities.prevX) && readFloats(cursor, end, entities.prevY) && readFloats(cursor, end, entities.prevZ)
+	       && readFloats(cursor, end, entities.halfX) && readFloats(cursor, end, entities.halfY) && readFloats(cursor, end, entities.halfZ)
+	       && (size_t)(end - cursor) >= entityCount;
+	if (!ok)
+	{
+		std::cerr << "Saved state is truncated" << std::endl;
+		return false;
+	}
+	memcpy(entities.kind.data(), cursor, entityCount);
+	return true;
+}
+// end::stateSerialisation[]
+
+// tag::InputRecorder[]
+bool InputRecorder::open(const std::string &filePath, double tickRate, int ballCount, float cellSize,
+                         const EntityStore &entities, const ArenaBounds &arena)
+{
+	path = filePath;
+	file.open(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cerr << "Input log could not be created - cannot write file " << filePath << std::endl;
+		return false;
+	}
+
+	std::vector<char> header(logMagic, logMagic + sizeof(logMagic));
+	appendValue(header, logVersion);
+	appendValue(header, tickRate);
+	appendValue(header, (int32_t)ballCount);
+	appendValue(header, cellSize);
+	appendValue(header, keyframeInterval);
+	std::vector<char> state = captureState(entities, arena);
+	header.insert(header.end(), state.begin(), state.end());
+	file.write(header.data(), header.size());
+
+	std::cout << "Recording input to " << filePath << std::endl;
+	return true;
+}
+
+void InputRecorder::beginTick(long long tick, const EntityStore &entities, const ArenaBounds &arena)
+{
+	if (!file.is_open() || keyframeInterval == 0 || tick == 0 || tick % keyframeInterval != 0)
+		return;
+
+	std::vector<char> record(1, 'K');
+	appendValue(record, (int64_t)tick);
+	std::vector<char> state = captureState(entities, arena);
+	record.insert(record.end(), state.begin(), state.end());
+	file.write(record.data(), record.size());
+}
+
+void InputRecorder::recordInput(InputAction action)
+{
+	if (!file.is_open())
+		return;
+	char record[2] = { 'I', (char)action };
+	file.write(record, sizeof(record));
+}
+
+void InputRecorder::endTick(const EntityStore &entities)
+{
+	if (!file.is_open())
+		return;
+	std::vector<char> record(1, 'C');
+	appendValue(record, stateChecksum(entities));
+	file.write(record.data(), record.size());
+}
+
+void InputRecorder::close(long long tickCount)
+{
+	if (!file.is_open())
+		return;
+	std::vector<char> record(1, 'E');
+	appendValue(record, (int64_t)tickCount);
+	file.write(record.data(), record.size());
+	file.close();
+	std::cout << "Input log of " << tickCount << " ticks saved to " << path << std::endl;
+}
+// end::InputRecorder[]
+
+// tag::load[]
+bool InputLog::load(const std::string &filePath)
+{
+	std::ifstream fileStream(filePath, std::ios::in | std::ios::binary);
+	if (!fileStream)
+	{
+		std::cerr << "Input log could not be loaded - cannot read file " << filePath << std::endl;
+		return false;
+	}
+	std::vector<char> data((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
+	const char *cursor = data.data();
+	const char *end = cursor + data.size();
+
+	uint32_t version;
+	int32_t loggedBallCount;
+	if (data.size() < sizeof(logMagic) || memcmp(cursor, logMagic, sizeof(logMagic)) != 0)
+	{
+		std::cerr << filePath << " is not an input log" << std::endl;
+		return false;
+	}
+	cursor += sizeof(logMagic);
+	if (!readValue(cursor, end, version) || version != logVersion
+		|| !readValue(cursor, end, tickRate) || !readValue(cursor, end, loggedBallCount)
+		|| !readValue(cursor, end, cellSize) || !readValue(cursor, end, keyframeInterval))
+	{
+		std::cerr << filePath << " has an unsupported version or a damaged header" << std::endl;
+		return false;
+	}
+	ballCount = loggedBallCount;
+
+	size_t size = stateSize(cursor, end);
+	if (size == 0)
+	{
+		std::cerr << filePath << " has a damaged initial state" << std::endl;
+		return false;
+	}
+	initialState.assign(cursor, cursor + size);
+	cursor += size;
+
+	bool ended = false;
+	while (cursor < end && !ended)
+	{
+		char tag = *cursor++;
+		switch (tag)
+		{
+		case 'I':
+		{
+			uint8_t action;
+			if (!readValue(cursor, end, action))
+				break;
+			ScriptedInput input = { (long long)checksums.size(), (InputAction)action };
+			inputs.push_back(input);
+			continue;
+		}
+		case 'C':
+		{
+			uint32_t checksum;
+			if (!readValue(cursor, end, checksum))
+				break;
+			checksums.push_back(checksum);
+			continue;
+		}
+		case 'K':
+		{
+			int64_t tick;
+			if (!readValue(cursor, end, tick) || (size = stateSize(cursor, end)) == 0)
+				break;
+			Keyframe keyframe;
+			keyframe.tick = tick;
+			keyframe.state.assign(cursor, cursor + size);
+			keyframes.push_back(keyframe);
+			cursor += size;
+			continue;
+		}
+		case 'E':
+			ended = true;
+			continue;
+		}
+		std::cerr << filePath << " is damaged at byte " << (cursor - data.data() - 1) << " - using the "
+		          << checksums.size() << " ticks before it" << std::endl;
+		break;
+	}
+
+	std::cout << "Input log loaded from " << filePath << ": " << checksums.size() << " ticks, " << inputs.size()
+	          << " inputs, " << keyframes.size() << " keyframes" << std::endl;
+	return true;
+}
+// end::load[]
+
+const InputLog::Keyframe *InputLog::keyframeAtOrBefore(long long tick) const
+{
+	const Keyframe *found = nullptr;
+	for (size_t i = 0; i < keyframes.size() && keyframes[i].tick <= tick; i++)
+		found = &keyframes[i];
+	return found;
+}
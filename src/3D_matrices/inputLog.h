@@ -0,0 +1,80 @@
+#ifndef INPUT_LOG_H
+#define INPUT_LOG_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "entityStore.h"
+#include "collision.h"
+#include "inputScript.h"
+
+// tag::inputLogFormat[]
+//binary input log - everything needed to re-run a game tick for tick
+//  header:  "PONGLOG1", uint32 version, double tickRate, int32 ballCount, float cellSize, uint32 keyframeInterval, state
+//  records: 'I' uint8 action      - an input, applied before the tick that the next 'C' closes
+//           'C' uint32 checksum   - closes a tick, with a checksum of the state after it
+//           'K' int64 tick, state - keyframe for seeking: the full state just before the given tick runs,
+//                                   with that tick's inputs (written before it) already applied
+//           'E' int64 tickCount   - end of log
+//  state:   uint32 entityCount, arena (6 floats), then pos/vel/prev/half (x, y and z each) as entityCount floats,
+//           then entityCount kind bytes
+//all values are in the byte order of the machine that wrote the log
+//the broadphase cell size is saved as it decides the order collisions are resolved in, and so the outcome
+// end::inputLogFormat[]
+
+// tag::stateChecksum[]
+//FNV-1a over the bits of every position and velocity - any divergence shows up within a tick
+uint32_t stateChecksum(const EntityStore &entities);
+// end::stateChecksum[]
+
+// tag::InputRecorder[]
+class InputRecorder
+{
+public:
+	InputRecorder() : keyframeInterval(1000) {}
+
+	uint32_t keyframeInterval; //ticks between keyframes (0 for none)
+
+	bool open(const std::string &filePath, double tickRate, int ballCount, float cellSize,
+	          const EntityStore &entities, const ArenaBounds &arena);
+	void beginTick(long long tick, const EntityStore &entities, const ArenaBounds &arena); //writes a keyframe when one is due
+	void recordInput(InputAction action);
+	void endTick(const EntityStore &entities);
+	void close(long long tickCount);
+
+private:
+	std::ofstream file;
+	std::string path;
+};
+// end::InputRecorder[]
+
+// tag::InputLog[]
+//a whole log, loaded into memory
+struct InputLog
+{
+	struct Keyframe
+	{
+		long long tick;
+		std::vector<char> state;
+	};
+
+	double tickRate;
+	int ballCount;
+	float cellSize;
+	uint32_t keyframeInterval;
+	std::vector<char> initialState;
+	std::vector<ScriptedInput> inputs; //in tick order
+	std::vector<uint32_t> checksums;   //checksums[t] is the state after tick t
+	std::vector<Keyframe> keyframes;   //in tick order
+
+	bool load(const std::string &filePath);
+	const Keyframe *keyframeAtOrBefore(long long tick) const; //nullptr if there is none
+};
+
+//overwrite the state of entities (which must already hold the same number of entities) and arena
+bool restoreState(const std::vector<char> &state, EntityStore &entities, ArenaBounds &arena);
+// end::InputLog[]
+
+#endif
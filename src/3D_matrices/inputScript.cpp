@@ -0,0 +1,86 @@
+#include "inputScript.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// tag::inputActionName[]
+const char *inputActionName(InputAction action)
+{
+	switch (action)
+	{
+	case INPUT_ACTION_QUIT: return "quit";
+	case INPUT_ACTION_FLIP_PADDLE1: return "paddle1";
+	case INPUT_ACTION_FLIP_PADDLE2: return "paddle2";
+	default: return "none";
+	}
+}
+
+InputAction parseInputAction(const std::string &name)
+{
+	if (name == "quit") return INPUT_ACTION_QUIT;
+	if (name == "paddle1") return INPUT_ACTION_FLIP_PADDLE1;
+	if (name == "paddle2") return INPUT_ACTION_FLIP_PADDLE2;
+	return INPUT_ACTION_NONE;
+}
+// end::inputActionName[]
+
+// tag::loadInputScript[]
+bool loadInputScript(const std::string &filePath, std::vector<ScriptedInput> &script)
+{
+	std::ifstream fileStream(filePath);
+	if (!fileStream)
+	{
+		std::cerr << "Input script could not be loaded - cannot read file " << filePath << std::endl;
+		return false;
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(fileStream, line))
+	{
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream lineStream(line);
+		ScriptedInput input;
+		std::string actionName;
+		if (!(lineStream >> input.tick))
+			continue; //blank or comment-only line
+
+		if (!(lineStream >> actionName) || (input.action = parseInputAction(actionName)) == INPUT_ACTION_NONE)
+		{
+			std::cerr << filePath << ":" << lineNumber << ": expected \"<tick> quit|paddle1|paddle2\"" << std::endl;
+			return false;
+		}
+		script.push_back(input);
+	}
+
+	std::stable_sort(script.begin(), script.end(),
+		[](const ScriptedInput &a, const ScriptedInput &b) { return a.tick < b.tick; });
+	std::cout << "Input script loaded from " << filePath << " (" << script.size() << " actions)" << std::endl;
+	return true;
+}
+// end::loadInputScript[]
+
+// tag::defaultInputScript[]
+std::vector<ScriptedInput> defaultInputScript(long long tickCount)
+{
+	std::vector<ScriptedInput> script;
+	for (long long tick = 1; tick < tickCount; tick++)
+	{
+		if (tick % 40 == 0)
+		{
+			ScriptedInput input = { tick, INPUT_ACTION_FLIP_PADDLE1 };
+			script.push_back(input);
+		}
+		if (tick % 55 == 0)
+		{
+			ScriptedInput input = { tick, INPUT_ACTION_FLIP_PADDLE2 };
+			script.push_back(input);
+		}
+	}
+	return script;
+}
+// end::defaultInputScript[]
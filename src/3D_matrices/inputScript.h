@@ -0,0 +1,37 @@
+#ifndef INPUT_SCRIPT_H
+#define INPUT_SCRIPT_H
+
+#include <string>
+#include <vector>
+
+// tag::InputAction[]
+//everything the player can do to the game - handleInput() turns SDL events into these,
+//  and scripted/replayed input feeds them straight to the simulation
+enum InputAction
+{
+	INPUT_ACTION_NONE = 0,
+	INPUT_ACTION_QUIT,
+	INPUT_ACTION_FLIP_PADDLE1,
+	INPUT_ACTION_FLIP_PADDLE2,
+};
+
+const char *inputActionName(InputAction action);
+InputAction parseInputAction(const std::string &name); //INPUT_ACTION_NONE if name is unknown
+// end::InputAction[]
+
+// tag::ScriptedInput[]
+//an action to apply at the start of a given simulation tick
+struct ScriptedInput
+{
+	long long tick;
+	InputAction action;
+};
+
+//reads a script of "<tick> <action>" lines ('#' starts a comment), sorted by tick on return
+bool loadInputScript(const std::string &filePath, std::vector<ScriptedInput> &script);
+
+//a repeatable stand-in for a player - flips each paddle at a different fixed interval
+std::vector<ScriptedInput> defaultInputScript(long long tickCount);
+// end::ScriptedInput[]
+
+#endif
@@ -0,0 +1,167 @@
+#include "instancedRenderer.h"
+#include "glState.h"
+
+#include <algorithm>
+#include <iostream>
+
+// tag::initialise[]
+void InstancedRenderer::initialise(const MeshPool &meshPool, GLint instanceTransformLocation, GLint instanceColorLocation, bool allowMultiDraw)
+{
+	pool = &meshPool;
+	transformLocation = instanceTransformLocation;
+	colorLocation = instanceColorLocation;
+
+	//per-instance attributes advance once per instance, not once per vertex
+	glState.bindVertexArray(pool->vertexArray());
+	glEnableVertexAttribArray(transformLocation);
+	glEnableVertexAttribArray(colorLocation);
+	glVertexAttribDivisor(transformLocation, 1);
+	glVertexAttribDivisor(colorLocation, 1);
+	glState.bindVertexArray(0);
+
+	stream.initialise(1024 * sizeof(InstanceData)); //grows if we need more
+
+	multiDrawIndirect = allowMultiDraw && GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance;
+	if (multiDrawIndirect)
+		commandStream.initialise(256 * sizeof(DrawElementsIndirectCommand));
+	std::cout << "Instanced renderer: " << (multiDrawIndirect ? "glMultiDrawElementsIndirect" : "one draw per mesh (no multi-draw indirect)") << std::endl;
+}
+
+void InstancedRenderer::shutdown()
+{
+	stream.shutdown();
+	if (multiDrawIndirect)
+		commandStream.shutdown();
+	batches.clear();
+}
+
+int InstancedRenderer::addBatch(int mesh)
+{
+	Batch batch;
+	batch.mesh = mesh;
+	batch.instanceCount = 0;
+	batch.firstInstance = 0;
+	batches.push_back(batch);
+	return (int)batches.size() - 1;
+}
+// end::initialise[]
+
+// tag::allocate[]
+void InstancedRenderer::beginFrame(size_t totalInstances)
+{
+	for (size_t i = 0; i < batches.size(); i++)
+		batches[i].instanceCount = 0;
+	drawCalls = 0;
+	frameUsed = 0;
+	frameCapacity = 0;
+	frameInstances = nullptr;
+
+	size_t bytes = totalInstances * sizeof(InstanceData);
+	if (bytes > stream.capacityPerFrame())
+		stream.grow(bytes);
+	stream.beginFrame();
+	if (totalInstances > 0)
+	{
+		frameInstances = (InstanceData *)stream.allocate(bytes, frameBufferOffset);
+		if (frameInstances != nullptr)
+			frameCapacity = totalInstances;
+	}
+
+	if (multiDrawIndirect)
+	{
+		size_t commandBytes = batches.size() * sizeof(DrawElementsIndirectCommand);
+		if (commandBytes > commandStream.capacityPerFrame())
+			commandStream.grow(commandBytes);
+		commandStream.beginFrame();
+	}
+}
+
+InstanceData *InstancedRenderer::allocate(int batch, size_t count)
+{
+	if (count == 0)
+		return nullptr;
+	if (frameUsed + count > frameCapacity)
+	{
+		std::cerr << "Instance block full - more instances than beginFrame() was told about" << std::endl;
+		return nullptr;
+	}
+
+	Batch &allocateBatch = batches[batch];
+	allocateBatch.firstInstance = frameUsed;
+	allocateBatch.instanceCount = count;
+	frameUsed += count;
+	return frameInstances + allocateBatch.firstInstance;
+}
+// end::allocate[]
+
+void InstancedRenderer::commit()
+{
+	stream.commit();
+}
+
+void InstancedRenderer::endFrame()
+{
+	stream.endFrame();
+	if (multiDrawIndirect)
+		commandStream.endFrame();
+}
+
+// tag::draw[]
+void InstancedRenderer::pointInstanceAttributes(size_t bufferOffset)
+{
+	glState.bindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+	glVertexAttribPointer(transformLocation, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (GLvoid *)(bufferOffset + offsetof(InstanceData, x)));
+	glVertexAttribPointer(colorLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(InstanceData), (GLvoid *)(bufferOffset + offsetof(InstanceData, color)));
+}
+
+void InstancedRenderer::drawAll()
+{
+	//build the commands on the CPU - skipping empty batches
+	commands.clear();
+	for (size_t i = 0; i < batches.size(); i++)
+	{
+		const Batch &batch = batches[i];
+		if (batch.instanceCount == 0)
+			continue;
+		const PooledMesh &mesh = pool->mesh(batch.mesh);
+		DrawElementsIndirectCommand command;
+		command.count = (GLuint)mesh.indexCount;
+		command.instanceCount = (GLuint)batch.instanceCount;
+		command.firstIndex = mesh.firstIndex;
+		command.baseVertex = mesh.baseVertex;
+		command.baseInstance = (GLuint)batch.firstInstance;
+		commands.push_back(command);
+	}
+	if (commands.empty())
+		return;
+
+	glState.bindVertexArray(pool->vertexArray());
+	size_t indexSize = (pool->indexType() == GL_UNSIGNED_SHORT) ? 2 : 4;
+
+	if (multiDrawIndirect)
+	{
+		size_t commandOffset = 0;
+		DrawElementsIndirectCommand *mapped = (DrawElementsIndirectCommand *)commandStream.allocate(commands.size() * sizeof(DrawElementsIndirectCommand), commandOffset);
+		if (mapped != nullptr)
+		{
+			std::copy(commands.begin(), commands.end(), mapped);
+			commandStream.commit();
+
+			pointInstanceAttributes(frameBufferOffset); //baseInstance does the rest
+			glState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandStream.buffer());
+			glMultiDrawElementsIndirect(GL_TRIANGLES, pool->indexType(), (GLvoid *)commandOffset, (GLsizei)commands.size(), 0);
+			drawCalls++;
+			return;
+		}
+	}
+
+	for (size_t i = 0; i < commands.size(); i++)
+	{
+		const DrawElementsIndirectCommand &command = commands[i];
+		pointInstanceAttributes(frameBufferOffset + command.baseInstance * sizeof(InstanceData));
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, pool->indexType(), (GLvoid *)(command.firstIndex * indexSize),
+			command.instanceCount, command.baseVertex);
+		drawCalls++;
+	}
+}
+// end::draw[]
@@ -0,0 +1,104 @@
+#ifndef INSTANCED_RENDERER_H
+#define INSTANCED_RENDERER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+#include "streamBuffer.h"
+
+// tag::InstanceData[]
+//what changes between copies of a mesh - 20 bytes per instance
+struct InstanceData
+{
+	float x, y, z; //translation
+	float scale;   //uniform scale
+	uint32_t color; //RGBA8, multiplied with the vertex colour
+};
+
+inline uint32_t packColor(float r, float g, float b, float a)
+{
+	return (uint32_t)(r * 255.0f + 0.5f) | ((uint32_t)(g * 255.0f + 0.5f) << 8)
+	     | ((uint32_t)(b * 255.0f + 0.5f) << 16) | ((uint32_t)(a * 255.0f + 0.5f) << 24);
+}
+// end::InstanceData[]
+
+// tag::DrawElementsIndirectCommand[]
+//one draw, laid out as glMultiDrawElementsIndirect reads it from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+	GLuint count; //indices
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance; //where this draw's instances start, counted in instances
+};
+// end::DrawElementsIndirectCommand[]
+
+// tag::InstancedRenderer[]
+//draws every copy of every mesh in the mesh pool
+//  - each mesh is a batch; each frame, allocate() hands out space for a batch's instances in the stream
+//    buffer, which the caller fills in directly - there's no copy between us and the GPU
+//  - all of a frame's instances are in one block, so a batch's instances are identified by where they start in it
+//  - drawAll() builds one DrawElementsIndirectCommand per batch on the CPU
+//    - with ARB_multi_draw_indirect (and ARB_base_instance) they go into an indirect buffer, and one
+//      glMultiDrawElementsIndirect call draws every batch
+//    - on plain GL 3.3 we loop over the commands instead, re-pointing the instance attributes at each
+//      command's first instance (there's no baseInstance) and issuing one glDrawElementsInstancedBaseVertex each
+class InstancedRenderer
+{
+public:
+	InstancedRenderer() : pool(nullptr), transformLocation(-1), colorLocation(-1), multiDrawIndirect(false),
+		frameInstances(nullptr), frameBufferOffset(0), frameCapacity(0), frameUsed(0), drawCalls(0) {}
+
+	void initialise(const MeshPool &meshPool, GLint instanceTransformLocation, GLint instanceColorLocation, bool allowMultiDraw = true);
+	void shutdown();
+
+	int addBatch(int mesh); //returns the batch id
+
+	void beginFrame(size_t totalInstances); //forget last frame's instances, and make room for this frame's
+	InstanceData *allocate(int batch, size_t count); //once per batch per frame - write count instances here
+	void commit(); //all instances written
+	void drawAll();
+	void endFrame(); //after the last draw
+
+	size_t batchCount() const { return batches.size(); }
+	size_t instanceCount(int batch) const { return batches[batch].instanceCount; }
+	size_t drawCallsLastFrame() const { return drawCalls; } //API calls, not commands
+	bool usingMultiDrawIndirect() const { return multiDrawIndirect; }
+	const StreamBuffer &streamBuffer() const { return stream; }
+
+private:
+	struct Batch
+	{
+		int mesh;
+		size_t instanceCount;
+		size_t firstInstance; //within this frame's block
+	};
+
+	void pointInstanceAttributes(size_t bufferOffset);
+
+	const MeshPool *pool;
+	std::vector<Batch> batches;
+	std::vector<DrawElementsIndirectCommand> commands;
+	StreamBuffer stream; //instances
+	StreamBuffer commandStream; //indirect commands, when we multi-draw
+	GLint transformLocation;
+	GLint colorLocation;
+	bool multiDrawIndirect;
+
+	InstanceData *frameInstances; //this frame's block in the stream buffer
+	size_t frameBufferOffset; //bytes, where that block starts in the buffer
+	size_t frameCapacity; //instances
+	size_t frameUsed;
+	size_t drawCalls;
+};
+// end::InstancedRenderer[]
+
+#endif
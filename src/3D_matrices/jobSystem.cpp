@@ -0,0 +1,213 @@
+#include "jobSystem.h"
+#include "traceEvents.h"
+
+#include <chrono>
+
+// tag::threadQueueIndex[]
+//which queue this thread owns - 0 for the main thread (and any other thread that isn't a worker and hasn't attached)
+static thread_local unsigned threadQueueIndex = 0;
+static thread_local const JobSystem *threadJobSystem = nullptr;
+// end::threadQueueIndex[]
+
+unsigned defaultWorkerCount()
+{
+	unsigned hardwareThreads = std::thread::hardware_concurrency();
+	return (hardwareThreads > 1) ? hardwareThreads - 1 : 0;
+}
+
+// tag::constructor[]
+JobSystem::JobSystem(unsigned workerCount, unsigned extraThreadCount)
+	: workerCount(workerCount), attachedThreads(0), queuedJobs(0), stopping(false)
+{
+	for (unsigned i = 0; i <= workerCount + extraThreadCount; i++)
+		queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+
+	for (unsigned i = 1; i <= workerCount; i++)
+		workers.push_back(std::thread(&JobSystem::workerLoop, this, i));
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		stopping = true;
+	}
+	wakeCondition.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+// end::constructor[]
+
+unsigned JobSystem::currentQueueIndex() const
+{
+	return (threadJobSystem == this) ? threadQueueIndex : 0;
+}
+
+void JobSystem::attachThread()
+{
+	unsigned queueIndex = workerCount + 1 + attachedThreads++;
+	if (queueIndex >= queues.size())
+		return; //no queue left for it - it keeps sharing queue 0
+	threadQueueIndex = queueIndex;
+	threadJobSystem = this;
+}
+
+// tag::submit[]
+JobHandle JobSystem::submit(std::function<void()> function, const std::vector<JobHandle> &dependencies)
+{
+	JobHandle job = std::make_shared<Job>();
+	job->function = std::move(function);
+	job->finished = false;
+	job->pendingDependencies = (int)dependencies.size() + 1; //+1 so it can't start before we finish registering
+
+	for (size_t i = 0; i < dependencies.size(); i++)
+	{
+		const JobHandle &dependency = dependencies[i];
+		std::lock_guard<std::mutex> lock(dependency->dependentsMutex);
+		if (dependency->finished)
+			job->pendingDependencies--;
+		else
+			dependency->dependents.push_back(job);
+	}
+
+	if (--job->pendingDependencies == 0)
+		enqueue(job);
+	return job;
+}
+// end::submit[]
+
+void JobSystem::enqueue(const JobHandle &job)
+{
+	WorkQueue &queue = *queues[currentQueueIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(job);
+	}
+	queuedJobs++;
+
+	if (!workers.empty())
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex); //pairs with the predicate check in workerLoop, so the wake can't be missed
+		wakeCondition.notify_one();
+	}
+}
+
+// tag::runOneJob[]
+bool JobSystem::runOneJob()
+{
+	unsigned ownIndex = currentQueueIndex();
+	JobHandle job;
+
+	//own queue first, newest job first
+	{
+		WorkQueue &queue = *queues[ownIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty())
+		{
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+		}
+	}
+
+	//otherwise steal the oldest job from someone else, starting with our neighbour so thieves spread out
+	//  - workers steal from anyone; other threads only from workers, so they never run each other's jobs
+	bool ownIsWorker = isWorkerQueue(ownIndex);
+	for (unsigned offset = 1; !job && offset < queues.size(); offset++)
+	{
+		unsigned victimIndex = (ownIndex + offset) % queues.size();
+		if (!ownIsWorker && !isWorkerQueue(victimIndex))
+			continue;
+		WorkQueue &victim = *queues[victimIndex];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			job = victim.jobs.front();
+			victim.jobs.pop_front();
+		}
+	}
+
+	if (!job)
+		return false;
+
+	queuedJobs--;
+	execute(job);
+	return true;
+}
+// end::runOneJob[]
+
+void JobSystem::execute(const JobHandle &job)
+{
+	job->function();
+
+	std::vector<JobHandle> dependents;
+	{
+		std::lock_guard<std::mutex> lock(job->dependentsMutex);
+		job->finished = true;
+		dependents.swap(job->dependents);
+	}
+
+	for (size_t i = 0; i < dependents.size(); i++)
+	{
+		if (--dependents[i]->pendingDependencies == 0)
+			enqueue(dependents[i]);
+	}
+}
+
+// tag::wait[]
+void JobSystem::wait(const JobHandle &job)
+{
+	while (!job->finished)
+	{
+		if (!runOneJob())
+			std::this_thread::yield(); //the job (or one it depends on) is running on another thread
+	}
+}
+// end::wait[]
+
+// tag::parallelFor[]
+void JobSystem::parallelFor(size_t begin, size_t end, size_t grainSize, const std::function<void(size_t, size_t)> &function)
+{
+	if (grainSize == 0)
+		grainSize = 1;
+
+	//not worth splitting - or nobody to split it with
+	if (end - begin <= grainSize || workers.empty())
+	{
+		if (begin < end)
+			function(begin, end);
+		return;
+	}
+
+	std::vector<JobHandle> chunks;
+	chunks.reserve((end - begin + grainSize - 1) / grainSize);
+	for (size_t chunkBegin = begin + grainSize; chunkBegin < end; chunkBegin += grainSize)
+	{
+		size_t chunkEnd = (end - chunkBegin > grainSize) ? chunkBegin + grainSize : end;
+		chunks.push_back(submit([&function, chunkBegin, chunkEnd]() { function(chunkBegin, chunkEnd); }));
+	}
+
+	function(begin, begin + grainSize); //do the first chunk ourselves while the workers steal the rest
+
+	for (size_t i = 0; i < chunks.size(); i++)
+		wait(chunks[i]);
+}
+// end::parallelFor[]
+
+// tag::workerLoop[]
+void JobSystem::workerLoop(unsigned queueIndex)
+{
+	threadQueueIndex = queueIndex;
+	threadJobSystem = this;
+	setTraceThreadName("job worker " + std::to_string(queueIndex));
+
+	while (!stopping)
+	{
+		if (runOneJob())
+			continue;
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		wakeCondition.wait_for(lock, std::chrono::milliseconds(10), [this]() { return stopping || queuedJobs > 0; });
+	}
+}
+// end::workerLoop[]
@@ -0,0 +1,86 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// tag::Job[]
+//a unit of work - hold on to the JobHandle to wait for it, or to make other jobs depend on it
+struct Job
+{
+	std::function<void()> function;
+	std::atomic<int> pendingDependencies; //job is queued when this reaches zero
+	std::atomic<bool> finished;
+
+	std::mutex dependentsMutex;
+	std::vector<std::shared_ptr<Job> > dependents; //jobs waiting for this one to finish
+};
+
+typedef std::shared_ptr<Job> JobHandle;
+// end::Job[]
+
+// tag::JobSystem[]
+//work-stealing thread pool
+//  - every worker, and the thread that created the JobSystem, has its own queue of jobs
+//  - a thread pushes and pops jobs at the back of its own queue (most recent first - cache friendly),
+//    and when that is empty it steals from the front of another thread's queue (oldest - likely the biggest)
+//  - threads that wait for a job run other jobs while they wait, so the main thread is never idle
+//  - a thread that isn't a worker only takes jobs from its own queue and the workers' - never from another
+//    such thread's, so two threads using the pool (the main and simulation threads) don't run each other's work
+class JobSystem
+{
+public:
+	//workers in addition to the calling thread, and queues for other threads that will attachThread()
+	explicit JobSystem(unsigned workerCount, unsigned extraThreadCount = 0);
+	~JobSystem();
+
+	void attachThread(); //give the calling thread one of the extra queues - until then it shares queue 0
+
+	//queue function to run once every job in dependencies has finished
+	JobHandle submit(std::function<void()> function, const std::vector<JobHandle> &dependencies = std::vector<JobHandle>());
+	void wait(const JobHandle &job); //runs other jobs until job has finished
+
+	//call function(chunkBegin, chunkEnd) over [begin, end), split into chunks of at most grainSize,
+	//  spread across every thread (including this one) - returns once all chunks are done
+	void parallelFor(size_t begin, size_t end, size_t grainSize, const std::function<void(size_t, size_t)> &function);
+
+	unsigned threadCount() const { return workerCount + 1; } //workers + the owning thread
+
+private:
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<JobHandle> jobs;
+	};
+
+	void enqueue(const JobHandle &job);
+	bool runOneJob(); //false if there was nothing to run
+	void execute(const JobHandle &job);
+	void workerLoop(unsigned queueIndex);
+	unsigned currentQueueIndex() const;
+	bool isWorkerQueue(unsigned queueIndex) const { return queueIndex >= 1 && queueIndex <= workerCount; }
+
+	//[0] is shared by every thread that isn't a worker and hasn't attached, [1, workers] are the workers',
+	//  and the attached threads' come after those
+	std::vector<std::unique_ptr<WorkQueue> > queues;
+	std::vector<std::thread> workers;
+	unsigned workerCount; //fixed before any worker starts - workers.size() isn't, while they're being created
+	std::atomic<unsigned> attachedThreads;
+
+	std::atomic<int> queuedJobs;
+	std::atomic<bool> stopping;
+	std::mutex wakeMutex;
+	std::condition_variable wakeCondition;
+};
+
+unsigned defaultWorkerCount(); //one worker per extra hardware thread
+// end::JobSystem[]
+
+#endif
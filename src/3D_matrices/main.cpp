@@ -15,6 +15,11 @@
 #include <algorithm>
 #include <string>
 #include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #include <GL/glew.h>
 #include <SDL.h>
@@ -25,6 +30,31 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include "glm/ext.hpp"
+
+#include "timing.h"
+#include "inputScript.h"
+#include "entityStore.h"
+#include "jobSystem.h"
+#include "spatialGrid.h"
+#include "collision.h"
+#include "inputLog.h"
+#include "renderSnapshot.h"
+#include "tripleBuffer.h"
+#include "profiler.h"
+#include "traceEvents.h"
+#include "gpuTimer.h"
+#include "instancedRenderer.h"
+#include "mesh.h"
+#include "camera.h"
+#include "glState.h"
+#include "frustum.h"
+#include "shaderManager.h"
+#include "assetLoader.h"
+#include "renderQueue.h"
+#include "proceduralMesh.h"
+#include "meshLod.h"
+#include "dynamicResolution.h"
+#include "offscreenContext.h"
 // end::includes[]
 
 // tag::using[]
@@ -42,33 +72,32 @@ using std::string;
 std::string exeName;
 SDL_Window *win; //pointer to the SDL_Window
 SDL_GLContext context; //the SDL_GLContext
+
+//where frames go - a window, or (--backend offscreen) a context with no window at all, drawing into the scene target
+enum RenderBackend
+{
+	RENDER_BACKEND_WINDOW = 0,
+	RENDER_BACKEND_OFFSCREEN
+};
+RenderBackend renderBackend = RENDER_BACKEND_WINDOW;
+OffscreenContext offscreenContext;
+
+//--benchmark - draw this many frames as fast as possible, once everything has loaded, then report frames/second
+long long benchmarkFrames = 0;
+int benchmarkStartFrame = -1; //frameCount when timing started; -1 until the scene is ready
+long long benchmarkStartTime = 0;
 int frameCount = 0;
 std::string frameLine = "";
 
-GLint uniform_mvp;
+FrameProfiler frameProfiler; //time spent in each phase of the main loop
+std::string profileReportPath = ""; //if set, frame timings are written here on exit (.csv or .json)
+long long lastStatusTime = 0; //when postRender() last printed the status line
+std::string tracePath = ""; //if set, a Chrome trace of the whole run is written here on exit
+GpuTimer gpuTimer; //GPU time of each pass, read back a few frames late so we never stall
 // end::globalVariables[]
 
-// tag::loadShader[]
-std::string loadShader(const string filePath) {
-    std::ifstream fileStream(filePath, std::ios::in | std::ios::binary);
-	if (fileStream)
-	{
-		string fileData( (std::istreambuf_iterator<char>(fileStream)),
-		                 (std::istreambuf_iterator<char>()          ));
-
-		cout << "Shader Loaded from " << filePath << endl;
-		return fileData;
-	}
-	else
-	{
-        cerr << "Shader could not be loaded - cannot read file " << filePath << ". File does not exist." << endl;
-        return "";
-	}
-}
-// end::loadShader[]
-
 //our variables
-bool done = false;
+std::atomic<bool> done(false); //atomic, as with --sim-thread both threads watch it
 
 GLfloat PaddleXZ = 0.1f;
 GLfloat PaddleY = 1.0f;
@@ -201,34 +230,107 @@ const GLfloat BallData[] = {
 
 //--------------------------------------------------------------------------------------
 
-
-GLfloat Pos1[] = { -0.9f, 0.0f };
-GLfloat Vel1[] = { 0.0f, 0.3f };
-
-GLfloat Pos2[] = { 0.9f, 0.0f };
-GLfloat Vel2[] = { 0.0f, -0.3f };
-
-GLfloat ballPos[] = { 0.0f, 0.0f };
-GLfloat ballVel[] = { -0.4f, 0.3f };
+//everything that moves lives in the entity store (structure-of-arrays, see entityStore.h)
+EntityStore entities;
+EntityHandle paddle1;
+EntityHandle paddle2;
+EntityHandle ball;
+
+int ballCount = 1; //the game has one ball, but we can add more to load-test the simulation and renderer
+
+//the simulation spreads big loops over every core
+JobSystem *jobSystem = nullptr;
+int workerThreadCount = -1; //-1: one per extra hardware thread
+size_t integrateGrainSize = 16384; //entities per job - big enough that scheduling is cheap compared to the work
+
+//collision detection
+ArenaBounds arena = { glm::vec3(-1.0f, -1.7f, -1.0f), glm::vec3(1.0f, 1.7f, 1.0f) }; //paddle centres turn at +-0.7, as they always have
+SpatialGrid broadphase;
+std::vector<CollisionPair> collisionPairs;
+long long contactCount = 0;
+long long sweptBounceCount = 0; //balls bounced off paddles by continuous collision
 // end::gameState[]
 
+// tag::fixedTimestep[]
+//the simulation advances in fixed ticks, independently of how often we render
+double simTickRate = 50.0; //ticks per second (50 matches the old hard-coded 0.02s step)
+int maxCatchUpSteps = 5; //most ticks we will run in a single frame
+double maxFrameTime = 0.25; //longest frame we'll try to simulate (seconds) - guards against a spiral of death after a stall
+double simAccumulator = 0.0; //simulated time we still owe (seconds)
+float renderAlpha = 1.0f; //how far we are between the previous and current tick, in [0,1]
+long long simTickCount = 0;
+long long droppedTicks = 0; //ticks we gave up on because we couldn't catch up
+// end::fixedTimestep[]
+
+// tag::headlessVariables[]
+long long headlessTicks = 0; //if > 0, run this many ticks with no window or GL, as fast as possible, then exit
+std::string inputScriptPath = ""; //script of actions to feed the headless simulation (default: defaultInputScript)
+// end::headlessVariables[]
+
+// tag::simulationThreadVariables[]
+//with --sim-thread the simulation runs on its own thread, and hands finished ticks to render() through snapshotBuffer
+bool useSimulationThread = false;
+std::thread simulationThread;
+TripleBuffer<RenderSnapshot> snapshotBuffer;
+std::mutex pendingInputMutex;
+std::vector<InputAction> pendingInputs; //from handleInput(), waiting for the simulation thread to apply them
+
+RenderSnapshot frameSnapshot; //without --sim-thread, captured on the main thread every frame
+const RenderSnapshot *renderState = &frameSnapshot; //what render() draws
+float renderStateAlpha = 1.0f; //how far render() blends from the start to the end of renderState's tick
+// end::simulationThreadVariables[]
+
+// tag::replayVariables[]
+InputRecorder inputRecorder;
+std::string recordPath = ""; //if set, record every input (and a checksum of every tick) here
+std::string replayPath = ""; //if set, re-run this recording headless at full speed and check it still matches
+long long replaySeekTick = 0; //start the replay from here, via the nearest keyframe
+// end::replayVariables[]
+
 // tag::GLVariables[]
 //our GL and GLSL variables
 //programIDs
 GLuint theProgram; //GLuint that we'll fill in to refer to the GLSL program (only have 1 at this point)
-
-//attribute locations
-GLint positionLocation; //GLuint that we'll fill in with the location of the `position` attribute in the GLSL
-GLint vertexColorLocation; //GLuint that we'll fill in with the location of the `vertexColor` attribute in the GLSL
-GLint translationVectorLocation;
-
-//uniform location
-GLint modelMatrixLocation;
-GLint viewMatrixLocation;
-GLint projectionMatrixLocation;
-
-GLuint vertexDataBufferObject[2];
-GLuint vertexArrayObject[2];
+bool useProgramCache = true; //--no-program-cache always compiles from source
+ShaderManager shaderManager; //builds programs, and rebuilds them when their shaders change
+bool watchShaders = true; //--no-shader-reload turns off rebuilding on change
+std::string programCachePath = "theProgram.programbinary"; //linked binary of theProgram, from the last launch
+
+//attribute locations - start as the layout(location = ...) values, so vertex arrays can be set up before the program is built
+GLint positionLocation = 0; //GLuint that we'll fill in with the location of the `position` attribute in the GLSL
+GLint vertexColorLocation = 1; //GLuint that we'll fill in with the location of the `vertexColor` attribute in the GLSL
+GLint instanceTransformLocation = 2; //per instance - translation and scale
+GLint instanceColorLocation = 3; //per instance - colour
+
+//view and projection live in a uniform buffer every program shares
+Camera camera;
+int windowWidth = 600; //drawable size, in pixels - kept up to date by SDL_WINDOWEVENT_SIZE_CHANGED
+int windowHeight = 600;
+
+//dynamic resolution - the scene is drawn offscreen, at whatever scale keeps frames within budget, then stretched to the window
+SceneTarget sceneTarget;
+ResolutionController resolutionController;
+bool useDynamicResolution = true; //--fixed-resolution draws straight to the window
+float frameBudgetMs = 16.0f; //--frame-budget - GPU time we aim to keep each frame under
+float minResolutionScale = 0.5f; //--min-scale
+
+MeshPool meshPool; //every mesh, in one vertex and one index buffer
+AssetLoader assetLoader; //builds meshes on its own thread, and uploads them a few at a time
+double uploadBudgetMs = 2.0; //--upload-budget - most time a frame spends uploading assets
+
+InstancedRenderer instancedRenderer; //one draw call per mesh, however many paddles and balls there are
+//paddles are rounded boxes and balls are spheres, each at several levels of detail - PaddleData and BallData are the coarsest
+MeshLod paddleLod;
+MeshLod ballLod;
+float maxLodPixelError = 1.0f; //--lod-error - how far, in pixels, a level of detail may be from the true shape
+//frustum culling - render() only draws what the camera can see
+FloatArray renderX, renderY, renderZ; //this frame's interpolated positions
+std::vector<uint32_t> visibleList; //indices into renderState of everything on screen
+size_t visibleCount = 0;
+bool allowMultiDraw = true; //--no-multi-draw forces the plain GL 3.3 path, to compare
+//draws are submitted as sort-keyed packets, then sorted and written to the instance buffer in one pass
+RenderQueue renderQueue;
+size_t renderGrainSize = 4096; //visible objects per job when building draw packets - one bucket per job
 // end::GLVariables[]
 
 
@@ -239,6 +341,7 @@ GLuint vertexArrayObject[2];
 // tag::initialise[]
 void initialise()
 {
+	TRACE_SCOPE("initialise");
 	if (SDL_Init(SDL_INIT_EVERYTHING) != 0){
 		cerr << "SDL_Init Error: " << SDL_GetError() << std::endl;
 		exit(1);
@@ -249,9 +352,20 @@ void initialise()
 
 
 
+// tag::createOffscreenContext[]
+//instead of initialise(), createWindow() and createContext() - no SDL video at all
+void createOffscreenContext()
+{
+	TRACE_SCOPE("createOffscreenContext");
+	if (!offscreenContext.create(3, 3)) //same version as setGLAttributes() asks SDL for
+		exit(1);
+}
+// end::createOffscreenContext[]
+
 // tag::createWindow[]
 void createWindow()
 {
+	TRACE_SCOPE("createWindow");
 	//get executable name, and use as window title
 	int beginIdxWindows = exeName.rfind("\\"); //find last occurrence of a backslash
 	int beginIdxLinux = exeName.rfind("/"); //find last occurrence of a forward slash
@@ -291,6 +405,7 @@ void setGLAttributes()
 // tag::createContext[]
 void createContext()
 {
+	TRACE_SCOPE("createContext");
 	setGLAttributes();
 
 	context = SDL_GL_CreateContext(win);
@@ -307,9 +422,17 @@ void createContext()
 // tag::initGlew[]
 void initGlew()
 {
+	TRACE_SCOPE("initGlew");
 	GLenum rev;
 	glewExperimental = GL_TRUE; //GLEW isn't perfect - see https://www.opengl.org/wiki/OpenGL_Loading_Library#GLEW
 	rev = glewInit();
+
+	//offscreen there's no GLX display, and newer GLEWs report that after they've loaded the GL functions - which are all we use
+	if (GLEW_OK != rev && renderBackend == RENDER_BACKEND_OFFSCREEN && glGenVertexArrays != nullptr)
+	{
+		cout << "GLEW: " << glewGetErrorString(rev) << " - not needed offscreen\n";
+		rev = GLEW_OK;
+	}
 	if (GLEW_OK != rev){
 		std::cerr << "GLEW Error: " << glewGetErrorString(rev) << std::endl;
 		SDL_Quit();
@@ -321,197 +444,165 @@ void initGlew()
 }
 // end::initGlew[]
 
-// tag::createShader[]
-GLuint createShader(GLenum eShaderType, const std::string &strShaderFile)
-{
-	GLuint shader = glCreateShader(eShaderType);
-	//error check
-	const char *strFileData = strShaderFile.c_str();
-	glShaderSource(shader, 1, &strFileData, NULL);
-
-	glCompileShader(shader);
-
-	GLint status;
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-	if (status == GL_FALSE)
-	{
-		GLint infoLogLength;
-		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
-
-		GLchar *strInfoLog = new GLchar[infoLogLength + 1];
-		glGetShaderInfoLog(shader, infoLogLength, NULL, strInfoLog);
-
-		const char *strShaderType = NULL;
-		switch (eShaderType)
-		{
-		case GL_VERTEX_SHADER: strShaderType = "vertex"; break;
-		case GL_GEOMETRY_SHADER: strShaderType = "geometry"; break;
-		case GL_FRAGMENT_SHADER: strShaderType = "fragment"; break;
-		}
-
-		fprintf(stderr, "Compile failure in %s shader:\n%s\n", strShaderType, strInfoLog);
-		delete[] strInfoLog;
-	}
-
-	return shader;
-}
-// end::createShader[]
-
-// tag::createProgram[]
-GLuint createProgram(const std::vector<GLuint> &shaderList)
-{
-	GLuint program = glCreateProgram();
-
-	for (size_t iLoop = 0; iLoop < shaderList.size(); iLoop++)
-		glAttachShader(program, shaderList[iLoop]);
-
-	glLinkProgram(program);
-
-	GLint status;
-	glGetProgramiv(program, GL_LINK_STATUS, &status);
-	if (status == GL_FALSE)
-	{
-		GLint infoLogLength;
-		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
-
-		GLchar *strInfoLog = new GLchar[infoLogLength + 1];
-		glGetProgramInfoLog(program, infoLogLength, NULL, strInfoLog);
-		fprintf(stderr, "Linker failure: %s\n", strInfoLog);
-		delete[] strInfoLog;
-	}
-
-	for (size_t iLoop = 0; iLoop < shaderList.size(); iLoop++)
-		glDetachShader(program, shaderList[iLoop]);
-
-	return program;
-}
-// end::createProgram[]
-
 // tag::initializeProgram[]
-void initializeProgram()
+//called each time a build of theProgram is swapped in - at startup, and whenever its shaders change
+void programReady(GLuint program)
 {
-	std::vector<GLuint> shaderList;
-
-	shaderList.push_back(createShader(GL_VERTEX_SHADER, loadShader("vertexShader.glsl")));
-	shaderList.push_back(createShader(GL_FRAGMENT_SHADER, loadShader("fragmentShader.glsl")));
-
-	theProgram = createProgram(shaderList);
-	if (theProgram == 0)
-	{
-		cerr << "GLSL program creation error." << std::endl;
-		SDL_Quit();
-		exit(1);
-	}
-	else {
-		cout << "GLSL program creation OK! GLUint is: " << theProgram << std::endl;
-	}
+	theProgram = program;
 
 	// tag::glGetAttribLocation[]
+	//fixed with layout(location = ...) in the GLSL, so they stay the same when the program is rebuilt
 	positionLocation = glGetAttribLocation(theProgram, "position");
 	vertexColorLocation = glGetAttribLocation(theProgram, "vertexColor");
+	instanceTransformLocation = glGetAttribLocation(theProgram, "instanceTransform");
+	instanceColorLocation = glGetAttribLocation(theProgram, "instanceColor");
 	// end::glGetAttribLocation[]
 
 	// tag::glGetUniformLocation[]
-	modelMatrixLocation = glGetUniformLocation(theProgram, "modelMatrix");
-	viewMatrixLocation = glGetUniformLocation(theProgram, "viewMatrix");
-	projectionMatrixLocation = glGetUniformLocation(theProgram, "projectionMatrix");
-
-	translationVectorLocation = glGetUniformLocation(theProgram, "Pos1");
-	translationVectorLocation = glGetUniformLocation(theProgram, "Pos2");
-	translationVectorLocation = glGetUniformLocation(theProgram, "ballPos");
+	//the matrices come from the camera's uniform block, not from uniforms we set one at a time
+	assert( glGetUniformBlockIndex(theProgram, "Camera") != GL_INVALID_INDEX);
+	camera.attachProgram(theProgram);
 
 	//only generates runtime code in debug mode
-	assert( modelMatrixLocation != -1);
-	assert( viewMatrixLocation != -1);
-	assert( projectionMatrixLocation != -1);
+	assert( instanceTransformLocation != -1);
+	assert( instanceColorLocation != -1);
 	// end::glGetUniformLocation[]
+}
 
-	//clean up shaders (we don't need them anymore as they are no in theProgram
-	for_each(shaderList.begin(), shaderList.end(), glDeleteShader);
+void initializeProgram()
+{
+	TRACE_SCOPE("initializeProgram");
+	shaderManager.initialise(watchShaders);
+
+	//starts every compile without waiting - a binary from the last launch skips them altogether
+	//we don't wait for it - frames are cleared, but nothing is drawn, until programReady() is called
+	shaderManager.addProgram("theProgram", "vertexShader.glsl", "fragmentShader.glsl",
+		useProgramCache ? programCachePath : std::string(), programReady);
+
+	//except for benchmarks - they only start timing once the program is ready, so a shader that fails to
+	//build would leave them clearing frames forever; wait, and stop with the error instead
+	if (benchmarkFrames > 0)
+		shaderManager.waitUntilReady();
 }
 // end::initializeProgram[]
 
 // tag::initializeVertexArrayObject[]
-//setup a GL object (a VertexArrayObject) that stores how to access data and from where
+//one vertex array describes every mesh in the pool - give it the per-instance attributes too
+//  - the pool starts empty; meshes are added to it as the asset loader finishes them
 void initializeVertexArrayObject()
 {
-	glGenVertexArrays(2, &vertexArrayObject[0]); //create a Vertex Array Object
-	cout << "Vertex Array Object created OK! GLUint is: " << vertexArrayObject << std::endl;
-
-	glBindVertexArray(vertexArrayObject[0]); //make the just created vertexArrayObject the active one
-
-		glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject[0]); //bind vertexDataBufferObject
-
-		glEnableVertexAttribArray(positionLocation); //enable attribute at index positionLocation
-		glEnableVertexAttribArray(vertexColorLocation); //enable attribute at index vertexColorLocation
-
-		// tag::glVertexAttribPointer[]
-		glVertexAttribPointer(positionLocation,    3, GL_FLOAT, GL_FALSE, (7 * sizeof(GL_FLOAT)), (GLvoid *) (0 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index positionLocation
-		glVertexAttribPointer(vertexColorLocation, 4, GL_FLOAT, GL_FALSE, (7 * sizeof(GL_FLOAT)), (GLvoid *) (3 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index vertexColorLocation
-		// end::glVertexAttribPointer[]
-
-	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
-
-
-	//----------------------------------------------------------------------------
-
-
-	glBindVertexArray(vertexArrayObject[1]); //make the just created vertexArrayObject the active one
-
-	glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject[1]); //bind vertexDataBufferObject
-
-	glEnableVertexAttribArray(positionLocation); //enable attribute at index positionLocation
-	glEnableVertexAttribArray(vertexColorLocation); //enable attribute at index vertexColorLocation
-
-	// tag::glVertexAttribPointer[]
-	glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, (7 * sizeof(GL_FLOAT)), (GLvoid *)(0 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index positionLocation
-	glVertexAttribPointer(vertexColorLocation, 4, GL_FLOAT, GL_FALSE, (7 * sizeof(GL_FLOAT)), (GLvoid *)(3 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index vertexColorLocation
-	// end::glVertexAttribPointer[]
-
-	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
-
-
-
-
-	//cleanup
-	glDisableVertexAttribArray(positionLocation); //disable vertex attribute at index positionLocation
-	glBindBuffer(GL_ARRAY_BUFFER, 0); //unbind array buffer
-
+	meshPool.upload(positionLocation, vertexColorLocation);
+	instancedRenderer.initialise(meshPool, instanceTransformLocation, instanceColorLocation, allowMultiDraw);
+	assetLoader.initialise(meshPool, positionLocation, vertexColorLocation, uploadBudgetMs);
 }
 // end::initializeVertexArrayObject[]
 
 // tag::initializeVertexBuffer[]
+//generate each level of detail, merge duplicate vertices into an index buffer and pack what's left - on the asset loader's thread
+//  - coarsest levels first, so there's something to draw as soon as possible
 void initializeVertexBuffer()
 {
-	glGenBuffers(2, vertexDataBufferObject);
-
-	glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject[0]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(PaddleData), PaddleData, GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject[0]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(PaddleData), PaddleData, GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ARRAY_BUFFER, vertexDataBufferObject[1]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(BallData), BallData, GL_STATIC_DRAW);
+	TRACE_SCOPE("initializeVertexBuffer");
+	initializeVertexArrayObject();
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	cout << "vertexDataBufferObject created OK! GLUint is: " << vertexDataBufferObject << std::endl;
+	//the boxes stick out of the shapes they stand in for by (sqrt(3) - 1) times the corner radius at each corner
+	const float paddleCornerRadius = PaddleXZ * 0.5f;
+	const glm::vec3 paddleHalfExtents(PaddleXZ, PaddleY, PaddleXZ);
+	std::shared_future<int> paddleLoads[4];
+	paddleLoads[3] = assetLoader.loadMesh("paddle box", [](IndexedMesh &mesh) {
+		buildIndexedMesh(PaddleData, sizeof(PaddleData) / (7 * sizeof(GLfloat)), mesh);
+	});
+	for (int level = 2; level >= 0; level--)
+	{
+		int cornerSegments = 4 >> level;
+		paddleLoads[level] = assetLoader.loadMesh("paddle lod " + std::to_string(level), [=](IndexedMesh &mesh) {
+			std::vector<GLfloat> vertexData;
+			generateRoundedBox(paddleHalfExtents, paddleCornerRadius, cornerSegments, vertexData);
+			buildIndexedMesh(vertexData.data(), vertexData.size() / 7, mesh);
+		});
+	}
+	for (int level = 0; level < 3; level++)
+		paddleLod.addLevel(paddleLoads[level], roundedBoxError(paddleCornerRadius, 4 >> level));
+	paddleLod.addLevel(paddleLoads[3], paddleCornerRadius * (sqrtf(3.0f) - 1.0f));
+
+	const float ballRadius = BallXYZ;
+	std::shared_future<int> ballLoads[5];
+	ballLoads[4] = assetLoader.loadMesh("ball box", [](IndexedMesh &mesh) {
+		buildIndexedMesh(BallData, sizeof(BallData) / (7 * sizeof(GLfloat)), mesh);
+	});
+	for (int level = 3; level >= 0; level--)
+	{
+		int subdivisions = 3 - level;
+		ballLoads[level] = assetLoader.loadMesh("ball lod " + std::to_string(level), [=](IndexedMesh &mesh) {
+			std::vector<GLfloat> vertexData;
+			generateIcosphere(ballRadius, subdivisions, vertexData);
+			buildIndexedMesh(vertexData.data(), vertexData.size() / 7, mesh);
+		});
+	}
+	for (int level = 0; level < 4; level++)
+		ballLod.addLevel(ballLoads[level], icosphereError(ballRadius, 3 - level));
+	ballLod.addLevel(ballLoads[4], ballRadius * (sqrtf(3.0f) - 1.0f));
+}
 
-	initializeVertexArrayObject();
+//once a frame - make a batch for each mesh that has finished loading
+void addLoadedBatches()
+{
+	paddleLod.addLoadedBatches(instancedRenderer);
+	ballLod.addLoadedBatches(instancedRenderer);
 }
 // end::initializeVertexBuffer[]
 
 // tag::loadAssets[]
+//only starts the loads - the first frames are drawn while they finish
 void loadAssets()
 {
+	TRACE_SCOPE("loadAssets");
 	initializeProgram(); //create GLSL Shaders, link into a GLSL program, and get IDs of attributes and variables
 
 	initializeVertexBuffer(); //load data into a vertex buffer
 
-	cout << "Loaded Assets OK!\n";
+	cout << "Started loading Assets OK!\n";
 }
 // end::loadAssets[]
 
+// tag::applyInputAction[]
+//the only place input changes the game state - shared by handleInput() and scripted input
+void applyInputAction(InputAction action)
+{
+	inputRecorder.recordInput(action); //does nothing unless we're recording
+
+	switch (action)
+	{
+	case INPUT_ACTION_QUIT: done = true;
+		break;
+	case INPUT_ACTION_FLIP_PADDLE1: entities.velY[entities.indexOf(paddle1)] *= -1.0f;
+		break;
+	case INPUT_ACTION_FLIP_PADDLE2: entities.velY[entities.indexOf(paddle2)] *= -1.0f;
+		break;
+	default:
+		break;
+	}
+}
+// end::applyInputAction[]
+
+// tag::submitInputAction[]
+//input from handleInput() - applied straight away, or queued for the simulation thread
+void submitInputAction(InputAction action)
+{
+	if (!useSimulationThread)
+	{
+		applyInputAction(action);
+		return;
+	}
+
+	if (action == INPUT_ACTION_QUIT)
+		done = true; //the render loop needs to stop too, not just the simulation
+
+	std::lock_guard<std::mutex> lock(pendingInputMutex);
+	pendingInputs.push_back(action);
+}
+// end::submitInputAction[]
+
 // tag::handleInput[]
 void handleInput()
 {
@@ -532,8 +623,18 @@ void handleInput()
 	{
 		switch (event.type)
 		{
+		case SDL_WINDOWEVENT:
+			//not game input, so this isn't recorded - it only changes how we draw
+			if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+			{
+				SDL_GL_GetDrawableSize(win, &windowWidth, &windowHeight); //pixels, which may not be window units on high-DPI displays
+				camera.setViewport(windowWidth, windowHeight);
+				sceneTarget.resize(windowWidth, windowHeight);
+			}
+			break;
+
 		case SDL_QUIT:
-			done = true; //set donecreate remote branch flag if SDL wants to quit (i.e. if the OS has triggered a close event,
+			submitInputAction(INPUT_ACTION_QUIT); //set done flag if SDL wants to quit (i.e. if the OS has triggered a close event,
 							//  - such as window close, or SIGINT
 			break;
 
@@ -556,11 +657,12 @@ void handleInput()
 					//	break;
 
 
-				case SDLK_ESCAPE: done = true;
+				case SDLK_ESCAPE: submitInputAction(INPUT_ACTION_QUIT);
+					break;
 					// use "a" and "d" to invert Paddle velocity
-				case SDLK_a: Vel1[1] *= -1.0f;
+				case SDLK_a: submitInputAction(INPUT_ACTION_FLIP_PADDLE1);
 					break;
-				case SDLK_d: Vel2[1] *= -1.0f;
+				case SDLK_d: submitInputAction(INPUT_ACTION_FLIP_PADDLE2);
 					break;
 
 				}
@@ -570,159 +672,893 @@ void handleInput()
 }
 // end::handleInput[]
 
-// tag::updateSimulation[]
-void updateSimulation(double simLength = 0.02) //update simulation with an amount of time to simulate for (in seconds)
+// tag::initialiseGameState[]
+//simple repeatable pseudo-random numbers in [-1, 1], so extra balls start in the same place every run
+float spawnRandom()
 {
-	//WARNING - we should calculate an appropriate amount of time to simulate - not always use a constant amount of time
-			// see, for example, http://headerphile.blogspot.co.uk/2014/07/part-9-no-more-delays.html
-
-	/*position1 += float(simLength) * velocity1;
-	position2 += float(simLength) * velocity2;
-	ballPosition += float(simLength) * ballVelocity;*/
+	static uint32_t state = 12345;
+	state = state * 1664525u + 1013904223u;
+	return (state >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
 
+void initialiseGameState()
+{
+	TRACE_SCOPE("initialiseGameState");
+	const glm::vec3 paddleHalfExtents(PaddleXZ, PaddleY, PaddleXZ);
+	const glm::vec3 ballHalfExtents(BallXYZ, BallXYZ, BallXYZ);
+
+	entities.reserve(2 + ballCount);
+	paddle1 = entities.create(ENTITY_PADDLE, glm::vec3(-0.9f, 0.0f, 0.0f), glm::vec3(0.0f, 0.3f, 0.0f), paddleHalfExtents);
+	paddle2 = entities.create(ENTITY_PADDLE, glm::vec3( 0.9f, 0.0f, 0.0f), glm::vec3(0.0f, -0.3f, 0.0f), paddleHalfExtents);
+	ball = entities.create(ENTITY_BALL, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-0.4f, 0.3f, 0.0f), ballHalfExtents);
+
+	//load testing with lots of balls - grow the arena so balls cover at most ~10% of it, otherwise they
+	//  are packed solid and every ball touches all its neighbours every tick
+	float ballArea = 4.0f * BallXYZ * BallXYZ * ballCount;
+	float arenaArea = (arena.max.x - arena.min.x) * (arena.max.y - arena.min.y);
+	if (ballArea > 0.1f * arenaArea)
+	{
+		float scale = std::sqrt(ballArea / (0.1f * arenaArea));
+		arena.min.x *= scale; arena.min.y *= scale;
+		arena.max.x *= scale; arena.max.y *= scale;
+		cout << "Arena grown " << scale << "x to fit " << ballCount << " balls\n";
+	}
 
+	for (int i = 1; i < ballCount; i++)
+	{
+		glm::vec3 position(arena.max.x * spawnRandom(), arena.max.y * spawnRandom(), 0.0f);
+		glm::vec3 velocity(0.5f * spawnRandom(), 0.5f * spawnRandom(), 0.0f);
+		entities.create(ENTITY_BALL, position, velocity, ballHalfExtents);
+	}
+	cout << "Game state created with " << entities.size() << " entities (" << simdInstructionSet() << " integrator)\n";
+}
+// end::initialiseGameState[]
 
-	Pos1[0] += (float)simLength * Vel1[0];
-	Pos1[1] += (float)simLength * Vel1[1];
+// tag::savePreviousState[]
+void savePreviousState()
+{
+	entities.savePrevious();
+}
+// end::savePreviousState[]
 
-	Pos2[0] += (float)simLength * Vel2[0];
-	Pos2[1] += (float)simLength * Vel2[1];
+// tag::updateSimulation[]
+void updateSimulation(double simLength = 0.02) //update simulation with an amount of time to simulate for (in seconds)
+{
+	TRACE_SCOPE("updateSimulation");
+	//simLength is always one fixed tick (1.0 / simTickRate) - see advanceSimulation()
 
-	ballPos[0] += (float)simLength * ballVel[0];
-	ballPos[1] += (float)simLength * ballVel[1];
+	const float dt = (float)simLength;
 
+	//broadphase over where everything will be during this tick, so fast balls can't skip past a paddle
+	{
+		TRACE_SCOPE("broadphase");
+		broadphase.build(entities, dt);
+		collisionPairs.clear();
+		broadphase.findPairs(collisionPairs);
+	}
 
-	if (Pos1[1] >= 0.7f)
+	//balls that would hit a paddle during the tick bounce at the moment of impact (continuous collision)
 	{
-		//reverse velocity on the collision axis, assuming X
-		Vel1[1] *= -1;
+		TRACE_SCOPE("sweepBallsAgainstPaddles");
+		sweptBounceCount += sweepBallsAgainstPaddles(entities, collisionPairs, dt);
 	}
 
+	//position += velocity * simLength, then bounce off the walls, for every entity - split into ranges across all cores
+	jobSystem->parallelFor(0, entities.size(), integrateGrainSize, [dt](size_t begin, size_t end)
+	{
+		TRACE_SCOPE("integrate");
+		entities.integrateRange(begin, end, dt);
+		collideWithArena(entities, begin, end, arena);
+	});
+
+	//whatever overlaps at the end of the tick (ball vs ball, mostly) - narrowphase separates and bounces them
+	{
+		TRACE_SCOPE("resolveCollisions");
+		contactCount += resolveCollisions(entities, collisionPairs);
+	}
 }
 // end::updateSimulation[]
 
-// tag::preRender[]
-void preRender()
+// tag::runTick[]
+//one fixed tick - every tick goes through here, so recordings see exactly what the simulation did
+void runTick(double simLength)
 {
-	glEnable(GL_DEPTH_TEST);
-	glViewport(0, 0, 600, 600); //set viewpoint
-	glClearColor(1.0f, 0.0f, 0.0f, 1.0f); //set clear colour
-	glClearDepth(1.0f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	inputRecorder.beginTick(simTickCount, entities, arena);
+	savePreviousState();
+	updateSimulation(simLength);
+	inputRecorder.endTick(entities);
+	simTickCount++;
 }
-// end::preRender[]
+// end::runTick[]
 
-// tag::render[]
-void render()
+// tag::advanceSimulation[]
+//run as many fixed ticks as the elapsed real time calls for
+//  - see, for example, http://gafferongames.com/game-physics/fix-your-timestep/
+void advanceSimulation(double frameTime)
 {
-	glUseProgram(theProgram); //installs the program object specified by program as part of current rendering state
+	if (frameTime > maxFrameTime)
+		frameTime = maxFrameTime; //after a long stall (debugger, window drag) don't try to simulate all of it
 
-	glBindVertexArray(vertexArrayObject[0]);
+	const double simLength = 1.0 / simTickRate;
+	simAccumulator += frameTime;
 
-	
-	glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0, 0.0, -1.0));
-	glm::mat4 view = glm::lookAt(glm::vec3(0.0, 0.0, 3.0), glm::vec3(0.0, 0.0, 0.0), glm::vec3(0.0, 1.0, 0.0));
-	glm::mat4 projection = glm::perspective(45.0f, 1.0f*600 / 600, 0.1f, 10.0f);
+	int steps = 0;
+	while (simAccumulator >= simLength && steps < maxCatchUpSteps)
+	{
+		runTick(simLength);
+		simAccumulator -= simLength;
+		steps++;
+	}
 
+	//spiral-of-death guard - if we still owe whole ticks we can't keep up, so drop them rather than
+	//  letting the backlog (and the time spent catching up) grow every frame
+	if (simAccumulator >= simLength)
+	{
+		long long behind = (long long)(simAccumulator / simLength);
+		droppedTicks += behind;
+		simAccumulator -= behind * simLength;
+	}
 
-	//set projectionMatrix - how we go from 3D to 2D
-	glUniformMatrix4fv(projectionMatrixLocation, 1, false, glm::value_ptr(projection));
-	
-	//set viewMatrix - how we control the view (viewpoint, view direction, etc)
-	glUniformMatrix4fv(viewMatrixLocation, 1, false, glm::value_ptr(view));
+	renderAlpha = (float)(simAccumulator / simLength);
+}
+// end::advanceSimulation[]
 
-	
-	modelMatrix = glm::translate(glm::mat4(1.0f), Pos1);	
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(modelMatrix));
+// tag::simulationThreadMain[]
+//the simulation thread - input, fixed ticks, and a snapshot for the renderer after each batch of ticks
+void simulationThreadMain()
+{
+	setTraceThreadName("simulation");
+	jobSystem->attachThread(); //its own job queue - otherwise it shares the main thread's
+	const double simLength = 1.0 / simTickRate;
+	std::vector<InputAction> inputs;
+	long long previousTime = nowNanoseconds();
 
-	glUniform2f(translationVectorLocation, Pos1[0], Pos1[1]);
-	glDrawArrays(GL_TRIANGLES, 0, 6 * 2 * 3);
+	while (!done)
+	{
+		{
+			std::lock_guard<std::mutex> lock(pendingInputMutex);
+			inputs.swap(pendingInputs);
+		}
+		for (size_t i = 0; i < inputs.size(); i++)
+			applyInputAction(inputs[i]);
+		inputs.clear();
 
+		long long currentTime = nowNanoseconds();
+		long long ticksBefore = simTickCount;
+		advanceSimulation((currentTime - previousTime) * 1e-9);
+		previousTime = currentTime;
 
-	modelMatrix = glm::translate(glm::mat4(1.0f), Pos2);
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(modelMatrix));
+		if (simTickCount != ticksBefore)
+		{
+			TRACE_SCOPE("publishSnapshot");
+			captureSnapshot(entities, simTickCount, simLength, snapshotBuffer.writeBuffer());
+			snapshotBuffer.publish();
+		}
 
-	glUniform2f(translationVectorLocation, Pos2[0], Pos2[1]);
-	glDrawArrays(GL_TRIANGLES, 0, 6 * 2 * 3);
+		//nothing to do until the next tick is due
+		std::this_thread::sleep_for(std::chrono::duration<double>(simLength - simAccumulator));
+	}
+}
 
+void startSimulationThread()
+{
+	//the renderer needs something to draw before the first tick finishes
+	captureSnapshot(entities, simTickCount, 1.0 / simTickRate, snapshotBuffer.writeBuffer());
+	snapshotBuffer.publish();
 
+	simulationThread = std::thread(simulationThreadMain);
+	cout << "Simulation running on its own thread\n";
+}
+// end::simulationThreadMain[]
 
-	glBindVertexArray(vertexArrayObject[1]);
+// tag::updateRenderState[]
+//pick the state render() will draw this frame
+void updateRenderState()
+{
+	if (!useSimulationThread)
+	{
+		captureSnapshot(entities, simTickCount, 1.0 / simTickRate, frameSnapshot);
+		renderStateAlpha = renderAlpha;
+		return;
+	}
 
-	modelMatrix = glm::translate(glm::mat4(1.0f), ballPos);
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(modelMatrix));
+	//take the newest tick the simulation has published, and blend through it over the following tick length
+	//  - so what we draw runs one tick behind the simulation, but moves smoothly
+	snapshotBuffer.update();
+	renderState = &snapshotBuffer.readBuffer();
+	double sincePublished = (nowNanoseconds() - renderState->publishTime) * 1e-9;
+	renderStateAlpha = (float)std::min(1.0, sincePublished / renderState->tickLength);
+}
+// end::updateRenderState[]
 
-	glUniform2f(translationVectorLocation, ballPos[0], ballPos[1]);
-	glDrawArrays(GL_TRIANGLES, 0, 6 * 2 * 3);
+// tag::preRender[]
+void preRender()
+{
+	//these rarely change, so after the first frame glState skips them
+	glState.enable(GL_DEPTH_TEST);
+	if (useDynamicResolution)
+		sceneTarget.bind(); //and sets the viewport to the scaled size
+	else
+		glState.viewport(0, 0, windowWidth, windowHeight); //set viewpoint
+	glState.clearColor(1.0f, 0.0f, 0.0f, 1.0f); //set clear colour
+	glState.clearDepth(1.0f);
 
+	ScopedGpuPass gpuPass(gpuTimer, GPU_PASS_CLEAR);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+// end::preRender[]
 
+// tag::render[]
+void render()
+{
+	if (theProgram == 0)
+		return; //still building - the frame is just the clear colour
+
+	glState.useProgram(theProgram); //installs the program object specified by program as part of current rendering state
+
+	camera.update(); //only does anything if the camera moved or the window changed size
+
+	//blend the last two ticks, then keep only what's inside the view frustum
+	//  - balls are spheres, so they're tested as spheres (radius halfX) - tighter than their boxes near a corner
+	renderState->interpolatePositions(renderStateAlpha, renderX, renderY, renderZ);
+	visibleList.resize(renderState->size());
+	size_t ballsBegin = renderState->ballsBegin;
+	visibleCount = cullBoxes(camera.frustum(), renderX.data(), renderY.data(), renderZ.data(),
+		renderState->halfX.data(), renderState->halfY.data(), renderState->halfZ.data(), ballsBegin, visibleList.data());
+	size_t visibleBalls = cullSpheres(camera.frustum(), renderX.data() + ballsBegin, renderY.data() + ballsBegin, renderZ.data() + ballsBegin,
+		renderState->halfX.data() + ballsBegin, renderState->size() - ballsBegin, visibleList.data() + visibleCount);
+	for (size_t v = visibleCount; v < visibleCount + visibleBalls; v++)
+		visibleList[v] += (uint32_t)ballsBegin; //cullSpheres counts from ballsBegin
+	visibleCount += visibleBalls;
+
+	//a draw packet for every visible paddle and ball, built across the job system - each job fills its own bucket
+	//  - a mesh that hasn't loaded yet has no batch, so its objects are skipped
+	renderQueue.reset((visibleCount + renderGrainSize - 1) / renderGrainSize);
+	{
+		TRACE_SCOPE("buildDrawPackets");
+		const glm::mat4 &viewProjection = camera.matrices().viewProjection;
+		const float depthScale = 1.0f / camera.farDistance();
+		const unsigned vertexArray = meshPool.vertexArray();
+		const float projectionScale = camera.projectionScale() * sceneTarget.scale(); //in scene pixels, not window pixels
+		jobSystem->parallelFor(0, visibleCount, renderGrainSize, [&](size_t begin, size_t end)
+		{
+			CommandBucket &bucket = renderQueue.bucket(begin / renderGrainSize);
+			const uint32_t white = packColor(1.0f, 1.0f, 1.0f, 1.0f);
+			for (size_t v = begin; v < end; v++)
+			{
+				uint32_t i = visibleList[v];
+				//clip-space w is the distance along the view direction
+				float depth = viewProjection[0][3] * renderX[i] + viewProjection[1][3] * renderY[i]
+				            + viewProjection[2][3] * renderZ[i] + viewProjection[3][3];
+
+				//the level of detail is a batch of its own - the coarsest one that looks right from here
+				const MeshLod &lod = (renderState->kind[i] == ENTITY_PADDLE) ? paddleLod : ballLod;
+				int batch = lod.select(depth, projectionScale, maxLodPixelError);
+				if (batch < 0)
+					continue;
+				DrawPacket packet;
+				packet.key = makeSortKey(RENDER_LAYER_OPAQUE, theProgram, 0, vertexArray, batch, depth * depthScale);
+				packet.instance = { renderX[i], renderY[i], renderZ[i], 1.0f, white };
+				bucket.push_back(packet);
+			}
+		});
+	}
 
+	//sorted, then written straight into each mesh's part of the stream buffer
+	{
+		TRACE_SCOPE("sortDrawPackets");
+		renderQueue.sort();
+	}
+	renderQueue.execute(instancedRenderer);
+	instancedRenderer.commit();
 
-	glBindVertexArray(0);
+	//every mesh - a single call with multi-draw indirect, otherwise one call per mesh
+	{
+		ScopedGpuPass gpuPass(gpuTimer, GPU_PASS_OBJECTS);
+		instancedRenderer.drawAll();
+	}
+	instancedRenderer.endFrame(); //fences this frame's instances, so we don't overwrite them while the GPU reads them
 
-	glUseProgram(0); //clean up
+	//we leave the program and vertex array bound - glState knows what's bound, so unbinding would
+	//only mean binding them again next frame
 }
 // end::render[]
 
+// tag::presentScene[]
+//stretch the scene over the window - part of the frame's GPU time, so it's timed with it
+void presentScene()
+{
+	if (!useDynamicResolution || renderBackend == RENDER_BACKEND_OFFSCREEN)
+		return; //offscreen, the scene target is the only place frames go
+
+	ScopedGpuPass gpuPass(gpuTimer, GPU_PASS_UPSCALE);
+	sceneTarget.present();
+}
+
+//pick the scale for the next frame - from GPU time if we can measure it, otherwise from the CPU time up to the swap
+void updateResolutionScale(long long frameStartTime)
+{
+	if (!useDynamicResolution)
+		return;
+
+	float frameMs = gpuTimer.enabled() ? gpuTimer.latestFrameMilliseconds() : (float)((nowNanoseconds() - frameStartTime) * 1e-6);
+	sceneTarget.setScale(resolutionController.update(frameMs));
+}
+// end::presentScene[]
+
+// tag::updateBenchmark[]
+//timing starts once the shaders and every mesh have loaded, so it covers only the fixed scene
+void updateBenchmark()
+{
+	if (benchmarkFrames <= 0)
+		return;
+
+	if (benchmarkStartFrame < 0)
+	{
+		if (theProgram != 0 && assetLoader.pendingCount() == 0)
+		{
+			benchmarkStartFrame = frameCount;
+			benchmarkStartTime = nowNanoseconds();
+		}
+		return;
+	}
+
+	long long frames = frameCount - benchmarkStartFrame;
+	if (frames < benchmarkFrames)
+		return;
+
+	glFinish(); //count the GPU's work too, not just what we've queued
+	double seconds = (nowNanoseconds() - benchmarkStartTime) * 1e-9;
+	cout << "\nBenchmark (" << (renderBackend == RENDER_BACKEND_OFFSCREEN ? "offscreen" : "window") << ", "
+	     << windowWidth << "x" << windowHeight << ", " << renderState->size() << " objects): "
+	     << frames << " frames in " << seconds << "s - " << frames / seconds << " frames/second, "
+	     << seconds * 1000.0 / frames << " ms/frame" << endl;
+	if (gpuTimer.enabled())
+		cout << "  gpu ms avg " << gpuTimer.frameSummary().mean << endl;
+	done = true;
+}
+// end::updateBenchmark[]
+
 // tag::postRender[]
 void postRender()
 {
-	SDL_GL_SwapWindow(win);; //present the frame buffer to the display (swapBuffers)
-	frameLine += "Frame: " + std::to_string(frameCount++);
-	cout << "\r" << frameLine << std::flush;
-	frameLine = "";
+	{
+		ScopedPhaseTimer timer(frameProfiler, PHASE_SWAP);
+		if (renderBackend == RENDER_BACKEND_OFFSCREEN)
+			glFlush(); //nothing to present - just make sure the frame is on its way to the GPU
+		else
+			SDL_GL_SwapWindow(win); //present the frame buffer to the display (swapBuffers)
+	}
+	frameCount++;
+
+	//writing to the console every frame costs more than some of our phases - once a second is plenty
+	long long now = nowNanoseconds();
+	if (now - lastStatusTime >= 1000000000LL)
+	{
+		SampleSummary frameStats = frameProfiler.summary(PHASE_FRAME);
+		frameLine = "Frame: " + std::to_string(frameCount) + "  frame ms avg " + std::to_string(frameStats.mean)
+		          + " p99 " + std::to_string(frameStats.p99)
+		          + "  visible " + std::to_string(visibleCount) + "/" + std::to_string(renderState->size())
+		          + "  draws " + std::to_string(instancedRenderer.drawCallsLastFrame())
+		          + (instancedRenderer.usingMultiDrawIndirect() ? " (multi-draw)" : "")
+		          + "  state groups " + std::to_string(renderQueue.stateGroupCount());
+		if (gpuTimer.enabled())
+			frameLine += "  gpu ms avg " + std::to_string(gpuTimer.frameSummary().mean);
+		if (useDynamicResolution)
+			frameLine += "  scale " + std::to_string((int)(sceneTarget.scale() * 100.0f + 0.5f)) + "%";
+		frameLine += "   ";
+		cout << "\r" << frameLine << std::flush;
+		lastStatusTime = now;
+	}
 }
 // end::postRender[]
 
 // tag::cleanUp[]
 void cleanUp()
 {
-	SDL_GL_DeleteContext(context);
-	SDL_DestroyWindow(win);
+	gpuTimer.printSummary();
+	gpuTimer.shutdown(); //while we still have a context
+	cout << "\nInstanced renderer: " << instancedRenderer.drawCallsLastFrame() << " draw calls in the last frame, for "
+	     << instancedRenderer.batchCount() << " meshes" << (instancedRenderer.usingMultiDrawIndirect() ? " (multi-draw indirect)" : "")
+	     << " - the render queue sorted its packets into " << renderQueue.stateGroupCount() << " state groups" << endl;
+	if (instancedRenderer.streamBuffer().stallCount() > 0)
+		cout << "\nStream buffer: waited for the GPU " << instancedRenderer.streamBuffer().stallCount() << " times" << endl;
+	assetLoader.shutdown(); //before the mesh pool it uploads to
+	instancedRenderer.shutdown();
+	if (useDynamicResolution)
+		cout << "\nDynamic resolution: changed scale " << resolutionController.changeCount() << " times, ended at "
+		     << sceneTarget.scale() << endl;
+	sceneTarget.shutdown();
+	camera.shutdown();
+	shaderManager.shutdown();
+	glState.printSummary();
+	meshPool.shutdown();
+	if (renderBackend == RENDER_BACKEND_OFFSCREEN)
+		offscreenContext.destroy();
+	else
+	{
+		SDL_GL_DeleteContext(context);
+		SDL_DestroyWindow(win);
+	}
+	cout << "\nSimulated " << simTickCount << " ticks";
+	if (droppedTicks > 0)
+		cout << " (dropped " << droppedTicks << " ticks we couldn't keep up with)";
+	cout << endl;
+	frameProfiler.printSummary();
+	if (!profileReportPath.empty())
+		frameProfiler.writeReport(profileReportPath);
+	delete jobSystem;
 	cout << "Cleaning up OK!\n";
 }
 // end::cleanUp[]
 
+// tag::reportThroughput[]
+void reportThroughput(const char *label, long long ticks, const std::vector<double> &stepTimes, double runSeconds)
+{
+	SampleSummary summary = summariseSamples(stepTimes);
+	cout << label << ": " << ticks << " ticks in " << runSeconds << "s\n";
+	cout << "  ticks/second: " << (runSeconds > 0.0 ? ticks / runSeconds : 0.0) << "\n";
+	cout << "  ns/tick:      " << (ticks > 0 ? runSeconds * 1e9 / ticks : 0.0) << " (including loop overhead)\n";
+	cout << "  step ns:      min " << summary.min << ", mean " << summary.mean << ", p50 " << summary.p50
+	     << ", p99 " << summary.p99 << ", max " << summary.max << "\n";
+	cout << "  contacts:     " << contactCount << " (" << (ticks > 0 ? (double)contactCount / ticks : 0.0) << " per tick), "
+	     << sweptBounceCount << " swept paddle bounces\n";
+	glm::vec3 ballPosition = entities.position(entities.indexOf(ball));
+	cout << "  final ball position: " << ballPosition.x << ", " << ballPosition.y << endl;
+}
+// end::reportThroughput[]
+
+// tag::runHeadless[]
+//step the simulation with scripted input as fast as the CPU allows, with no window or GL context at all
+//  - useful for soak tests and benchmarking the game logic on machines with no display
+void runHeadless()
+{
+	std::vector<ScriptedInput> script;
+	if (inputScriptPath.empty())
+		script = defaultInputScript(headlessTicks);
+	else if (!loadInputScript(inputScriptPath, script))
+		exit(1);
+
+	const double simLength = 1.0 / simTickRate;
+	std::vector<double> stepTimes; //nanoseconds per tick
+	stepTimes.reserve((size_t)headlessTicks);
+
+	cout << "Running " << headlessTicks << " ticks headless at " << simLength << "s per tick\n";
+
+	size_t nextInput = 0;
+	long long runStart = nowNanoseconds();
+	for (long long tick = 0; tick < headlessTicks && !done; tick++)
+	{
+		while (nextInput < script.size() && script[nextInput].tick <= tick)
+			applyInputAction(script[nextInput++].action);
+
+		long long stepStart = nowNanoseconds();
+		runTick(simLength);
+		stepTimes.push_back((double)(nowNanoseconds() - stepStart));
+	}
+	double runSeconds = (nowNanoseconds() - runStart) * 1e-9;
+
+	reportThroughput("Headless run", simTickCount, stepTimes, runSeconds);
+}
+// end::runHeadless[]
+
+// tag::runReplay[]
+//re-run a recording as fast as possible with no window or GL context, checking every tick against the recorded
+//  checksum - a repeatable benchmark, and a quick check that a change didn't alter the game's behaviour
+//  - returns false if the replay diverged from the recording
+bool runReplay(const InputLog &log)
+{
+	const double simLength = 1.0 / simTickRate;
+	const long long tickCount = (long long)log.checksums.size();
+	size_t nextInput = 0;
+
+	//jump to the nearest keyframe, rather than re-simulating everything before it
+	if (replaySeekTick > 0)
+	{
+		long long seekStart = nowNanoseconds();
+		const InputLog::Keyframe *keyframe = log.keyframeAtOrBefore(replaySeekTick);
+		if (keyframe != nullptr && restoreState(keyframe->state, entities, arena))
+		{
+			simTickCount = keyframe->tick;
+			while (nextInput < log.inputs.size() && log.inputs[nextInput].tick <= keyframe->tick)
+				nextInput++; //already applied when the keyframe was taken
+		}
+		while (simTickCount < replaySeekTick && simTickCount < tickCount)
+		{
+			while (nextInput < log.inputs.size() && log.inputs[nextInput].tick <= simTickCount)
+				applyInputAction(log.inputs[nextInput++].action);
+			runTick(simLength);
+		}
+		cout << "Seeked to tick " << simTickCount << " in " << (nowNanoseconds() - seekStart) * 1e-6 << "ms ("
+		     << (keyframe ? "from the keyframe at tick " + std::to_string(keyframe->tick) : string("no keyframe - from the start")) << ")\n";
+	}
+
+	cout << "Replaying ticks " << simTickCount << " to " << tickCount << " headless\n";
+
+	std::vector<double> stepTimes; //nanoseconds per tick
+	stepTimes.reserve((size_t)(tickCount - simTickCount));
+	long long firstTick = simTickCount;
+	long long mismatches = 0;
+	long long firstMismatch = -1;
+
+	long long runStart = nowNanoseconds();
+	while (simTickCount < tickCount)
+	{
+		long long tick = simTickCount;
+		while (nextInput < log.inputs.size() && log.inputs[nextInput].tick <= tick)
+			applyInputAction(log.inputs[nextInput++].action);
+
+		long long stepStart = nowNanoseconds();
+		runTick(simLength);
+		stepTimes.push_back((double)(nowNanoseconds() - stepStart));
+
+		if (stateChecksum(entities) != log.checksums[(size_t)tick])
+		{
+			if (mismatches++ == 0)
+				firstMismatch = tick;
+		}
+	}
+	double runSeconds = (nowNanoseconds() - runStart) * 1e-9;
+
+	reportThroughput("Replay", simTickCount - firstTick, stepTimes, runSeconds);
+	if (mismatches > 0)
+	{
+		cerr << "Replay DIVERGED from the recording at tick " << firstMismatch << " (" << mismatches << " ticks differ)" << endl;
+		return false;
+	}
+	cout << "Replay matched the recording on every tick\n";
+	return true;
+}
+// end::runReplay[]
+
+// tag::parseArguments[]
+void parseArguments(int argc, char* args[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = args[i];
+		bool hasValue = (i + 1 < argc);
+
+		if (arg == "--tick-rate" && hasValue)
+		{
+			simTickRate = atof(args[++i]);
+			if (simTickRate <= 0.0)
+			{
+				cerr << "--tick-rate must be greater than zero" << endl;
+				exit(1);
+			}
+		}
+		else if (arg == "--max-catch-up" && hasValue)
+		{
+			maxCatchUpSteps = max(1, atoi(args[++i]));
+		}
+		else if (arg == "--headless" && hasValue)
+		{
+			headlessTicks = atoll(args[++i]);
+			if (headlessTicks <= 0)
+			{
+				cerr << "--headless needs a number of ticks greater than zero" << endl;
+				exit(1);
+			}
+		}
+		else if (arg == "--balls" && hasValue)
+		{
+			ballCount = max(1, atoi(args[++i]));
+		}
+		else if (arg == "--threads" && hasValue)
+		{
+			workerThreadCount = max(0, atoi(args[++i]) - 1); //the main thread is one of them
+		}
+		else if (arg == "--grain" && hasValue)
+		{
+			integrateGrainSize = (size_t)max(8, atoi(args[++i]));
+		}
+		else if (arg == "--cell-size" && hasValue)
+		{
+			broadphase.cellSize = (float)atof(args[++i]);
+			if (broadphase.cellSize <= 0.0f)
+			{
+				cerr << "--cell-size must be greater than zero" << endl;
+				exit(1);
+			}
+		}
+		else if (arg == "--sim-thread")
+		{
+			useSimulationThread = true;
+		}
+		else if (arg == "--no-multi-draw")
+		{
+			allowMultiDraw = false;
+		}
+		else if (arg == "--no-program-cache")
+		{
+			useProgramCache = false;
+		}
+		else if (arg == "--no-shader-reload")
+		{
+			watchShaders = false;
+		}
+		else if (arg == "--backend" && hasValue)
+		{
+			string backend = args[++i];
+			if (backend == "window")
+				renderBackend = RENDER_BACKEND_WINDOW;
+			else if (backend == "offscreen")
+				renderBackend = RENDER_BACKEND_OFFSCREEN;
+			else
+			{
+				cerr << "--backend must be window or offscreen" << endl;
+				exit(1);
+			}
+		}
+		else if (arg == "--benchmark" && hasValue)
+		{
+			benchmarkFrames = atoll(args[++i]);
+			if (benchmarkFrames <= 0)
+			{
+				cerr << "--benchmark must be greater than zero" << endl;
+				exit(1);
+			}
+		}
+		else if (arg == "--fixed-resolution")
+		{
+			useDynamicResolution = false;
+		}
+		else if (arg == "--frame-budget" && hasValue)
+		{
+			frameBudgetMs = (float)atof(args[++i]);
+			if (frameBudgetMs <= 0.0f)
+			{
+				cerr << "--frame-budget must be greater than zero" << endl;
+				exit(1);
+			}
+		}
+		else if (arg == "--min-scale" && hasValue)
+		{
+			minResolutionScale = (float)atof(args[++i]);
+			if (minResolutionScale <= 0.0f || minResolutionScale > 1.0f)
+			{
+				cerr << "--min-scale must be greater than zero and at most 1" << endl;
+				exit(1);
+			}
+		}
+		else if (arg == "--lod-error" && hasValue)
+		{
+			maxLodPixelError = (float)atof(args[++i]);
+			if (maxLodPixelError <= 0.0f)
+			{
+				cerr << "--lod-error must be greater than zero" << endl;
+				exit(1);
+			}
+		}
+		else if (arg == "--upload-budget" && hasValue)
+		{
+			uploadBudgetMs = atof(args[++i]);
+			if (uploadBudgetMs <= 0.0)
+			{
+				cerr << "--upload-budget must be greater than zero" << endl;
+				exit(1);
+			}
+		}
+		else if (arg == "--profile-out" && hasValue)
+		{
+			profileReportPath = args[++i];
+		}
+		else if (arg == "--trace" && hasValue)
+		{
+			tracePath = args[++i];
+		}
+		else if (arg == "--record" && hasValue)
+		{
+			recordPath = args[++i];
+		}
+		else if (arg == "--replay" && hasValue)
+		{
+			replayPath = args[++i];
+		}
+		else if (arg == "--seek" && hasValue)
+		{
+			replaySeekTick = max(0LL, atoll(args[++i]));
+		}
+		else if (arg == "--keyframe-interval" && hasValue)
+		{
+			inputRecorder.keyframeInterval = (uint32_t)max(0, atoi(args[++i]));
+		}
+		else if (arg == "--script" && hasValue)
+		{
+			inputScriptPath = args[++i];
+		}
+		else
+		{
+			cerr << "Unknown or incomplete argument: " << arg << endl;
+			exit(1);
+		}
+	}
+
+	//a benchmark steps one tick a frame so it always draws the same scene - the simulation thread keeps its own
+	//wall-clock time, so with it the scene would depend on how fast frames come (offscreen is always a benchmark)
+	if (useSimulationThread && (benchmarkFrames > 0 || renderBackend == RENDER_BACKEND_OFFSCREEN))
+	{
+		cerr << "--sim-thread can't be used with --benchmark or --backend offscreen" << endl;
+		exit(1);
+	}
+	cout << "Simulation tick rate " << simTickRate << "Hz, at most " << maxCatchUpSteps << " ticks per frame\n";
+}
+// end::parseArguments[]
+
 // tag::main[]
 int main( int argc, char* args[] )
 {
 	exeName = args[0];
+	parseArguments(argc, args);
+	if (renderBackend == RENDER_BACKEND_OFFSCREEN && benchmarkFrames == 0)
+		benchmarkFrames = 1000; //with no window, there's nothing to close to stop it
+
+	if (!tracePath.empty())
+	{
+		startTracing(); //before anything else, so the trace covers startup too
+		setTraceThreadName("main");
+	}
+
+	//a replay has to start from exactly the game that was recorded
+	InputLog replayLog;
+	if (!replayPath.empty())
+	{
+		if (!replayLog.load(replayPath))
+			exit(1);
+		simTickRate = replayLog.tickRate;
+		ballCount = replayLog.ballCount;
+		broadphase.cellSize = replayLog.cellSize;
+	}
+
+	initialiseGameState();
+
+	if (!replayPath.empty() && !restoreState(replayLog.initialState, entities, arena))
+		exit(1);
+	if (!recordPath.empty() && !inputRecorder.open(recordPath, simTickRate, ballCount, broadphase.cellSize, entities, arena))
+		exit(1);
+
+	//with --sim-thread, a queue for the simulation thread too - so it and the render thread don't run each other's jobs
+	jobSystem = new JobSystem(workerThreadCount < 0 ? defaultWorkerCount() : (unsigned)workerThreadCount, useSimulationThread ? 1 : 0);
+	cout << "Job system running on " << jobSystem->threadCount() << " threads\n";
+
+	if (!replayPath.empty() || headlessTicks > 0)
+	{
+		//no SDL, window or GL context - just the game logic
+		bool matched = true;
+		if (!replayPath.empty())
+			matched = runReplay(replayLog);
+		else
+			runHeadless();
+
+		inputRecorder.close(simTickCount);
+		delete jobSystem;
+		if (!tracePath.empty())
+			writeTrace(tracePath);
+		return matched ? 0 : 1;
+	}
+
 	//setup
 	//- do just once
-	initialise();
-	createWindow();
+	if (renderBackend == RENDER_BACKEND_OFFSCREEN)
+	{
+		createOffscreenContext(); //draws at the size the window would have started at
+	}
+	else
+	{
+		initialise();
+		createWindow();
 
-	createContext();
+		createContext();
+	}
 
 	initGlew();
 
-	glViewport(0,0,600,600); //should check what the actual window res is?
+	if (renderBackend == RENDER_BACKEND_WINDOW)
+	{
+		SDL_GL_GetDrawableSize(win, &windowWidth, &windowHeight);
+		if (benchmarkFrames > 0)
+			SDL_GL_SetSwapInterval(0); //don't wait for vsync - we want to know how fast we can go
+	}
+	glState.viewport(0, 0, windowWidth, windowHeight);
 
-	SDL_GL_SwapWindow(win); //force a swap, to make the trace clearer
+	if (renderBackend == RENDER_BACKEND_WINDOW)
+		SDL_GL_SwapWindow(win); //force a swap, to make the trace clearer
 
 
 	//do stuff that only needs to happen once
 	//- create shaders
 	//- load vertex data
+	camera.initialise(); //before loadAssets, so programs can attach to its uniform block
+	camera.lookAt(glm::vec3(0.0, 0.0, 3.0), glm::vec3(0.0, 0.0, 0.0), glm::vec3(0.0, 1.0, 0.0));
+	camera.setPerspective(45.0f, 0.1f, 10.0f);
+	camera.setViewport(windowWidth, windowHeight);
 	loadAssets();
 
+	gpuTimer.initialise();
+
+	//offscreen there's no default framebuffer, so the scene target is needed whatever --fixed-resolution says
+	if (renderBackend == RENDER_BACKEND_OFFSCREEN)
+		useDynamicResolution = true;
+	if (useDynamicResolution)
+		useDynamicResolution = sceneTarget.initialise(windowWidth, windowHeight);
+	if (renderBackend == RENDER_BACKEND_OFFSCREEN && !useDynamicResolution)
+	{
+		cerr << "The offscreen backend can't draw without the scene target" << endl;
+		exit(1);
+	}
+
+	//offscreen and benchmarks draw a fixed scene at full resolution, so runs can be compared
+	if (renderBackend == RENDER_BACKEND_OFFSCREEN || benchmarkFrames > 0)
+		resolutionController.configure(frameBudgetMs, 1.0f, 1.0f);
+	else
+		resolutionController.configure(frameBudgetMs, minResolutionScale, 1.0f);
+
+	if (useSimulationThread)
+		startSimulationThread();
+
+	Uint64 previousCounter = SDL_GetPerformanceCounter();
+
 	while (!done) //loop until done flag is set)
 	{
-		handleInput(); // this should ONLY SET VARIABLES
+		frameProfiler.beginFrame();
+		long long frameStartTime = nowNanoseconds();
+
+		Uint64 currentCounter = SDL_GetPerformanceCounter();
+		double frameTime = (double)(currentCounter - previousCounter) / SDL_GetPerformanceFrequency();
+		previousCounter = currentCounter;
+
+		//benchmarks step one tick a frame, so the scene is the same however fast frames are drawn
+		if (benchmarkFrames > 0)
+			frameTime = 1.0 / simTickRate;
 
-		updateSimulation(); // this should ONLY SET VARIABLES according to simulation
+		{
+			ScopedPhaseTimer timer(frameProfiler, PHASE_INPUT);
+			if (renderBackend == RENDER_BACKEND_WINDOW)
+				handleInput(); // this should ONLY SET VARIABLES
+		}
 
-		preRender();
+		{
+			ScopedPhaseTimer timer(frameProfiler, PHASE_SIMULATION);
+			if (!useSimulationThread)
+				advanceSimulation(frameTime); // this should ONLY SET VARIABLES according to simulation - runs 0 or more fixed ticks
+
+			updateRenderState(); // latest finished tick, from this thread or the simulation thread
+		}
+
+		gpuTimer.beginFrame(); // also picks up GPU timings of earlier frames that have finished
+
+		{
+			ScopedPhaseTimer timer(frameProfiler, PHASE_PRE_RENDER);
+			shaderManager.update(); //swaps in rebuilt shaders - only ever polls, so it won't hold up the frame
+			assetLoader.update(); //uploads what the loader thread has finished, within the budget
+			addLoadedBatches();
+			preRender();
+		}
+
+		{
+			ScopedPhaseTimer timer(frameProfiler, PHASE_RENDER);
+			render(); // this should render the world state according to VARIABLES -
+			presentScene();
+		}
 
-		render(); // this should render the world state according to VARIABLES -
+		gpuTimer.endFrame();
+		updateResolutionScale(frameStartTime);
 
-		postRender();
+		postRender(); // times the swap itself
 
+		frameProfiler.endFrame();
+		updateBenchmark();
 	}
 
 	//cleanup and exit
+	if (simulationThread.joinable())
+		simulationThread.join(); //it stops once it sees done
+	inputRecorder.close(simTickCount);
 	cleanUp();
 	SDL_Quit();
+	if (!tracePath.empty())
+		writeTrace(tracePath); //after cleanUp(), so every worker thread has finished
 
 	return 0;
 }
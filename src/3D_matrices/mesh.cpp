@@ -0,0 +1,136 @@
+#include "mesh.h"
+#include "glState.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <utility>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+// tag::buildIndexedMesh[]
+bool buildIndexedMesh(const GLfloat *vertexData, size_t vertexCount, IndexedMesh &mesh)
+{
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	mesh.indices.reserve(vertexCount);
+
+	//key on the packed bits, so vertices that only differ below half-float precision are merged too
+	std::map<std::pair<uint64_t, uint32_t>, uint16_t> seen;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const GLfloat *v = vertexData + i * 7;
+		PackedVertex packed;
+		packed.x = glm::packHalf1x16(v[0]);
+		packed.y = glm::packHalf1x16(v[1]);
+		packed.z = glm::packHalf1x16(v[2]);
+		packed.pad = 0;
+		packed.color = glm::packUnorm4x8(glm::vec4(v[3], v[4], v[5], v[6]));
+
+		std::pair<uint64_t, uint32_t> key((uint64_t)packed.x | ((uint64_t)packed.y << 16) | ((uint64_t)packed.z << 32), packed.color);
+		std::map<std::pair<uint64_t, uint32_t>, uint16_t>::iterator found = seen.find(key);
+		if (found == seen.end())
+		{
+			//indices are 16 bits - one more vertex and they would wrap round and draw garbage
+			if (mesh.vertices.size() > 0xFFFF)
+			{
+				std::cerr << "Mesh rejected - more than 65536 distinct vertices won't fit in 16-bit indices" << std::endl;
+				mesh.vertices.clear();
+				mesh.indices.clear();
+				return false;
+			}
+			found = seen.insert(std::make_pair(key, (uint16_t)mesh.vertices.size())).first;
+			mesh.vertices.push_back(packed);
+		}
+		mesh.indices.push_back(found->second);
+	}
+	return true;
+}
+// end::buildIndexedMesh[]
+
+// tag::MeshPool[]
+int MeshPool::add(const IndexedMesh &mesh)
+{
+	PooledMesh pooled;
+	pooled.firstIndex = (GLuint)indices.size();
+	pooled.indexCount = (GLsizei)mesh.indices.size();
+	pooled.baseVertex = (GLint)vertices.size();
+	meshes.push_back(pooled);
+
+	vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+	indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+	return (int)meshes.size() - 1;
+}
+
+//send whatever the GPU doesn't have yet to one of the pool's buffers - growing it (and so sending everything) if it's full
+//  - capacity doubles, so meshes added one at a time don't copy the whole pool each time
+static size_t uploadRange(GLenum target, size_t elementSize, const void *data, size_t count, size_t &uploaded, size_t &capacity)
+{
+	size_t bytes;
+	if (count > capacity)
+	{
+		capacity = std::max(count, capacity * 2);
+		glBufferData(target, capacity * elementSize, nullptr, GL_STATIC_DRAW);
+		glBufferSubData(target, 0, count * elementSize, data);
+		bytes = count * elementSize;
+	}
+	else
+	{
+		bytes = (count - uploaded) * elementSize;
+		if (bytes > 0)
+			glBufferSubData(target, uploaded * elementSize, bytes, (const char *)data + uploaded * elementSize);
+	}
+	uploaded = count;
+	return bytes;
+}
+
+size_t MeshPool::upload(GLint positionLocation, GLint colorLocation)
+{
+	bool firstUpload = (vertexArrayObject == 0);
+	if (firstUpload)
+	{
+		glGenVertexArrays(1, &vertexArrayObject);
+		glGenBuffers(1, &vertexBuffer);
+		glGenBuffers(1, &indexBuffer);
+	}
+
+	glState.bindVertexArray(vertexArrayObject);
+
+		glState.bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		size_t bytes = uploadRange(GL_ARRAY_BUFFER, sizeof(PackedVertex), vertices.data(), vertices.size(), uploadedVertices, vertexCapacity);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer); //the element buffer binding is stored in the vertex array
+		bytes += uploadRange(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t), indices.data(), indices.size(), uploadedIndices, indexCapacity);
+
+		if (firstUpload)
+		{
+			// tag::glVertexAttribPointer[]
+			glEnableVertexAttribArray(positionLocation);
+			glEnableVertexAttribArray(colorLocation);
+			glVertexAttribPointer(positionLocation, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (GLvoid *)offsetof(PackedVertex, x));
+			glVertexAttribPointer(colorLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (GLvoid *)offsetof(PackedVertex, color));
+			// end::glVertexAttribPointer[]
+		}
+
+	glState.bindVertexArray(0);
+	glState.bindBuffer(GL_ARRAY_BUFFER, 0);
+
+	std::cout << "Mesh pool uploaded OK! " << meshes.size() << " meshes, " << vertices.size() << " vertices, " << indices.size()
+	          << " indices (sent " << bytes << " bytes)" << std::endl;
+	return bytes;
+}
+
+void MeshPool::shutdown()
+{
+	glState.deleteVertexArrays(1, &vertexArrayObject);
+	glState.deleteBuffers(1, &vertexBuffer);
+	glState.deleteBuffers(1, &indexBuffer);
+	vertexArrayObject = vertexBuffer = indexBuffer = 0;
+	uploadedVertices = uploadedIndices = vertexCapacity = indexCapacity = 0;
+	meshes.clear();
+	vertices.clear();
+	indices.clear();
+}
+// end::MeshPool[]
@@ -0,0 +1,78 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+// tag::PackedVertex[]
+//a vertex as the GPU reads it - 12 bytes instead of 7 floats (28 bytes)
+//  - position is three half-floats (plus one for padding, so the colour stays 4-byte aligned)
+//  - colour is RGBA8, packed with glm::packUnorm4x8 and normalised back to 0..1 by GL
+struct PackedVertex
+{
+	uint16_t x, y, z, pad;
+	uint32_t color;
+};
+// end::PackedVertex[]
+
+// tag::IndexedMesh[]
+//a mesh with each distinct vertex stored once, and triangles made from indices into them
+struct IndexedMesh
+{
+	std::vector<PackedVertex> vertices;
+	std::vector<uint16_t> indices;
+};
+
+//build an indexed mesh from fully expanded vertices of 7 floats (X Y Z R G B A) each
+//  - vertices that are identical once packed are merged
+//  - false, and an empty mesh, if more than 65536 distinct vertices are left - too many for 16-bit indices
+bool buildIndexedMesh(const GLfloat *vertexData, size_t vertexCount, IndexedMesh &mesh);
+// end::IndexedMesh[]
+
+// tag::MeshPool[]
+//where a mesh lives inside the pool's shared buffers
+struct PooledMesh
+{
+	GLuint firstIndex; //in indices, not bytes
+	GLsizei indexCount;
+	GLint baseVertex; //added to each index, so every mesh keeps its own 16-bit indices
+};
+
+//every mesh in one vertex buffer and one index buffer, described by one vertex array object
+//  - all meshes share the PackedVertex layout, so one vertex array covers them all, and draws of
+//    different meshes need no state change in between - which is what lets a multi-draw submit them together
+//  - add() meshes, then upload(); upload() again after adding more - only the new meshes are sent, unless
+//    the buffers have to grow, and the vertex array (and anything else set up on it) stays
+class MeshPool
+{
+public:
+	MeshPool() : uploadedVertices(0), uploadedIndices(0), vertexCapacity(0), indexCapacity(0),
+	             vertexArrayObject(0), vertexBuffer(0), indexBuffer(0) {}
+
+	int add(const IndexedMesh &mesh); //returns the mesh id
+	size_t upload(GLint positionLocation, GLint colorLocation); //needs a current GL context - returns the bytes sent
+	void shutdown();
+
+	const PooledMesh &mesh(int id) const { return meshes[id]; }
+	size_t meshCount() const { return meshes.size(); }
+	GLuint vertexArray() const { return vertexArrayObject; }
+	GLenum indexType() const { return GL_UNSIGNED_SHORT; }
+
+private:
+	std::vector<PooledMesh> meshes;
+	std::vector<PackedVertex> vertices;
+	std::vector<uint16_t> indices;
+	size_t uploadedVertices; //how much of vertices and indices the GPU already has
+	size_t uploadedIndices;
+	size_t vertexCapacity; //size of the GL buffers, in vertices and indices
+	size_t indexCapacity;
+	GLuint vertexArrayObject;
+	GLuint vertexBuffer;
+	GLuint indexBuffer;
+};
+// end::MeshPool[]
+
+#endif
@@ -0,0 +1,37 @@
+#include "meshLod.h"
+#include "assetLoader.h"
+
+// tag::MeshLod[]
+void MeshLod::addLevel(const std::shared_future<int> &meshLoad, float error)
+{
+	Level level = { meshLoad, -1, error };
+	levels.push_back(level);
+}
+
+void MeshLod::addLoadedBatches(InstancedRenderer &renderer)
+{
+	for (size_t i = 0; i < levels.size(); i++)
+		if (levels[i].batch == -1 && isReady(levels[i].meshLoad))
+		{
+			int meshId = levels[i].meshLoad.get();
+			levels[i].batch = (meshId < 0) ? -2 : renderer.addBatch(meshId);
+		}
+}
+
+int MeshLod::select(float distance, float projectionScale, float maxPixelError) const
+{
+	//error * projectionScale / distance is the error in pixels - compare without dividing
+	//  - coarsest first; if no level is good enough, the finest one that has loaded
+	float allowed = maxPixelError * distance;
+	int finest = -1;
+	for (size_t i = levels.size(); i-- > 0; )
+	{
+		if (levels[i].batch < 0)
+			continue;
+		if (levels[i].error * projectionScale <= allowed)
+			return levels[i].batch;
+		finest = levels[i].batch;
+	}
+	return finest;
+}
+// end::MeshLod[]
@@ -0,0 +1,39 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <future>
+#include <vector>
+
+#include "instancedRenderer.h"
+
+// tag::MeshLod[]
+//one object's mesh at several levels of detail, finest first
+//  - each level knows its geometric error: how far, in world units, it can be from the true shape
+//  - select() projects each level's error onto the screen at the instance's distance, and picks the coarsest
+//    level that is out by no more than maxPixelError pixels - so far away objects cost a handful of triangles
+//  - levels load in the background; until a level has loaded, select() uses the nearest one that has
+class MeshLod
+{
+public:
+	void addLevel(const std::shared_future<int> &meshLoad, float error);
+	void addLoadedBatches(InstancedRenderer &renderer); //once a frame - a batch for each level whose mesh has arrived
+
+	//projectionScale is pixels per world unit at distance 1 (Camera::projectionScale) - returns a batch, -1 if nothing has loaded
+	int select(float distance, float projectionScale, float maxPixelError) const;
+
+	size_t levelCount() const { return levels.size(); }
+	int batch(size_t level) const { return levels[level].batch; }
+
+private:
+	struct Level
+	{
+		std::shared_future<int> meshLoad;
+		int batch; //-1 until the mesh has loaded, -2 if it failed to
+		float error;
+	};
+
+	std::vector<Level> levels;
+};
+// end::MeshLod[]
+
+#endif
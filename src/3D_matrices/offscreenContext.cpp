@@ -0,0 +1,105 @@
+#include "offscreenContext.h"
+
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+	#include <EGL/egl.h>
+	#include <EGL/eglext.h>
+	#define OFFSCREEN_CONTEXT_EGL
+#endif
+
+#ifdef OFFSCREEN_CONTEXT_EGL
+static bool hasExtension(const char *extensions, const char *name)
+{
+	if (extensions == nullptr)
+		return false;
+	size_t length = strlen(name);
+	for (const char *found = strstr(extensions, name); found != nullptr; found = strstr(found + length, name))
+		if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+			return true;
+	return false;
+}
+#endif
+
+// tag::create[]
+bool OffscreenContext::create(int majorVersion, int minorVersion)
+{
+#ifdef OFFSCREEN_CONTEXT_EGL
+	//surfaceless needs no X server, no Wayland compositor and no GPU device
+	EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+	if (hasExtension(eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS), "EGL_MESA_platform_surfaceless"))
+	{
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay != nullptr)
+			eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (eglDisplay == EGL_NO_DISPLAY)
+		eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint eglMajor = 0;
+	EGLint eglMinor = 0;
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &eglMajor, &eglMinor))
+	{
+		std::cerr << "eglInitialize Error: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+		return false;
+	}
+	display = eglDisplay;
+
+	if (!hasExtension(eglQueryString(eglDisplay, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context"))
+	{
+		std::cerr << "EGL Error: EGL_KHR_surfaceless_context isn't supported" << std::endl;
+		destroy();
+		return false;
+	}
+
+	//we never make a surface, but EGL_SURFACE_TYPE defaults to window - and surfaceless has no window configs
+	const EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config;
+	EGLint configCount = 0;
+	if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount) || configCount == 0)
+	{
+		std::cerr << "EGL Error: no desktop OpenGL config (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+		destroy();
+		return false;
+	}
+
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION_KHR, majorVersion,
+		EGL_CONTEXT_MINOR_VERSION_KHR, minorVersion,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+		EGL_NONE
+	};
+	context = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, (EGLContext)context))
+	{
+		std::cerr << "eglCreateContext Error: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+		destroy();
+		return false;
+	}
+
+	std::cout << "Created offscreen OpenGL context OK! EGL " << eglMajor << "." << eglMinor << ", "
+	          << eglQueryString(eglDisplay, EGL_VENDOR) << std::endl;
+	return true;
+#else
+	(void)majorVersion;
+	(void)minorVersion;
+	std::cerr << "The offscreen backend needs EGL, which this build doesn't have" << std::endl;
+	return false;
+#endif
+}
+// end::create[]
+
+void OffscreenContext::destroy()
+{
+#ifdef OFFSCREEN_CONTEXT_EGL
+	if (display == nullptr)
+		return;
+	eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (context != nullptr && context != EGL_NO_CONTEXT)
+		eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+	eglTerminate((EGLDisplay)display);
+#endif
+	display = nullptr;
+	context = nullptr;
+}
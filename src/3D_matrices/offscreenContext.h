@@ -0,0 +1,24 @@
+#ifndef OFFSCREEN_CONTEXT_H
+#define OFFSCREEN_CONTEXT_H
+
+// tag::OffscreenContext[]
+//an OpenGL context with no window, for running the renderer on servers with no display
+//  - EGL on Mesa's surfaceless platform (EGL_MESA_platform_surfaceless) if it's there, otherwise the default
+//    EGL display - and no surface at all (EGL_KHR_surfaceless_context), so it works with llvmpipe and no GPU
+//  - with no surface there's no default framebuffer, so everything has to be drawn into a framebuffer object
+//  - Linux only; elsewhere create() says so and fails
+class OffscreenContext
+{
+public:
+	OffscreenContext() : display(nullptr), context(nullptr) {}
+
+	bool create(int majorVersion, int minorVersion); //core profile, made current on the calling thread
+	void destroy();
+
+private:
+	void *display; //EGLDisplay and EGLContext - kept as void * so EGL's headers stay out of ours
+	void *context;
+};
+// end::OffscreenContext[]
+
+#endif
@@ -0,0 +1,127 @@
+#include "proceduralMesh.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const float pi = 3.14159265358979f;
+
+static void addVertex(const glm::vec3 &position, const glm::vec3 &normal, std::vector<GLfloat> &vertexData)
+{
+	glm::vec3 color = glm::abs(normal);
+	GLfloat vertex[7] = { position.x, position.y, position.z, color.r, color.g, color.b, 1.0f };
+	vertexData.insert(vertexData.end(), vertex, vertex + 7);
+}
+
+static float tessellationError(float radius, float edgeAngle)
+{
+	return radius * (1.0f - cosf(edgeAngle * 0.5f));
+}
+
+// tag::generateIcosphere[]
+//split each triangle into four, pushing the new corners out onto the sphere - much more even than
+//rings of latitude and longitude, which bunch up at the poles
+static void subdivideTriangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c, int depth, float radius,
+                              std::vector<GLfloat> &vertexData)
+{
+	if (depth == 0)
+	{
+		addVertex(a * radius, a, vertexData);
+		addVertex(b * radius, b, vertexData);
+		addVertex(c * radius, c, vertexData);
+		return;
+	}
+
+	glm::vec3 ab = glm::normalize(a + b);
+	glm::vec3 bc = glm::normalize(b + c);
+	glm::vec3 ca = glm::normalize(c + a);
+	subdivideTriangle(a, ab, ca, depth - 1, radius, vertexData);
+	subdivideTriangle(ab, b, bc, depth - 1, radius, vertexData);
+	subdivideTriangle(ca, bc, c, depth - 1, radius, vertexData);
+	subdivideTriangle(ab, bc, ca, depth - 1, radius, vertexData);
+}
+
+void generateIcosphere(float radius, int subdivisions, std::vector<GLfloat> &vertexData)
+{
+	//an icosahedron's corners are the corners of three golden rectangles at right angles to each other
+	const float t = (1.0f + sqrtf(5.0f)) * 0.5f;
+	const glm::vec3 corners[12] = {
+		glm::vec3(-1, t, 0), glm::vec3(1, t, 0), glm::vec3(-1, -t, 0), glm::vec3(1, -t, 0),
+		glm::vec3(0, -1, t), glm::vec3(0, 1, t), glm::vec3(0, -1, -t), glm::vec3(0, 1, -t),
+		glm::vec3(t, 0, -1), glm::vec3(t, 0, 1), glm::vec3(-t, 0, -1), glm::vec3(-t, 0, 1)
+	};
+	const int faces[20][3] = {
+		{0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11},
+		{1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+		{3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+		{4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}
+	};
+
+	for (int f = 0; f < 20; f++)
+		subdivideTriangle(glm::normalize(corners[faces[f][0]]), glm::normalize(corners[faces[f][1]]),
+		                  glm::normalize(corners[faces[f][2]]), std::max(subdivisions, 0), radius, vertexData);
+}
+
+float icosphereError(float radius, int subdivisions)
+{
+	const float edgeAngle = 1.1071487f; //between neighbouring corners of an icosahedron - each subdivision about halves it
+	return tessellationError(radius, edgeAngle / (float)(1 << std::max(subdivisions, 0)));
+}
+// end::generateIcosphere[]
+
+// tag::generateRoundedBox[]
+//a grid on each face of the box, with every point pulled onto the surface of a box shrunk by cornerRadius,
+//  then pushed back out by cornerRadius along the direction it was pulled - flat faces stay flat, and
+//  edges and corners become quarter cylinders and eighth spheres
+void generateRoundedBox(const glm::vec3 &halfExtents, float cornerRadius, int cornerSegments, std::vector<GLfloat> &vertexData)
+{
+	cornerSegments = std::max(cornerSegments, 1);
+	cornerRadius = std::min(cornerRadius, std::min(halfExtents.x, std::min(halfExtents.y, halfExtents.z)));
+	const glm::vec3 inner = halfExtents - glm::vec3(cornerRadius);
+
+	//grid lines along each axis - cornerSegments of them across each rounded edge, and one span across the flat middle
+	//  - the lines sit at inner + r * sin(pi/2 * k / N), which isn't even in angle once projected onto a face:
+	//    each face tessellates its half of each edge with N segments, at most pi / (2N) apart - what roundedBoxError assumes
+	std::vector<float> lines[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (int k = 0; k <= cornerSegments; k++)
+			lines[axis].push_back(-inner[axis] - cornerRadius * cosf(0.5f * pi * k / cornerSegments));
+		for (int k = 0; k <= cornerSegments; k++)
+			lines[axis].push_back(inner[axis] + cornerRadius * sinf(0.5f * pi * k / cornerSegments));
+	}
+
+	for (int axis = 0; axis < 3; axis++)
+		for (int side = -1; side <= 1; side += 2)
+		{
+			//u and v go round the face so its triangles wind counter-clockwise seen from outside
+			int u = (axis + (side > 0 ? 1 : 2)) % 3;
+			int v = (axis + (side > 0 ? 2 : 1)) % 3;
+			for (size_t i = 0; i + 1 < lines[u].size(); i++)
+				for (size_t j = 0; j + 1 < lines[v].size(); j++)
+				{
+					glm::vec3 quad[4];
+					for (int c = 0; c < 4; c++)
+					{
+						glm::vec3 onBox;
+						onBox[axis] = side * halfExtents[axis];
+						onBox[u] = lines[u][i + (c & 1)];
+						onBox[v] = lines[v][j + (c >> 1)];
+						quad[c] = onBox;
+					}
+
+					const int order[6] = { 0, 1, 2, 1, 3, 2 };
+					for (int k = 0; k < 6; k++)
+					{
+						glm::vec3 onInner = glm::clamp(quad[order[k]], -inner, inner);
+						glm::vec3 normal = glm::normalize(quad[order[k]] - onInner);
+						addVertex(onInner + normal * cornerRadius, normal, vertexData);
+					}
+				}
+		}
+}
+
+float roundedBoxError(float cornerRadius, int cornerSegments)
+{
+	return tessellationError(cornerRadius, 0.5f * pi / std::max(cornerSegments, 1));
+}
+// end::generateRoundedBox[]
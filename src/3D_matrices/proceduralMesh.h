@@ -0,0 +1,27 @@
+#ifndef PROCEDURAL_MESH_H
+#define PROCEDURAL_MESH_H
+
+#include <vector>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+// tag::proceduralMesh[]
+//meshes built from code instead of typed-in vertex data
+//  - each generator writes fully expanded triangles of 7 floats (X Y Z R G B A), the same layout as
+//    PaddleData and BallData, so buildIndexedMesh merges the shared vertices and packs them like any other mesh
+//  - there's no lighting, so each vertex is coloured by its normal (|nx|, |ny|, |nz|) - the shape shows
+//    up as a blend of red, green and blue
+//  - all are centred on the origin
+void generateIcosphere(float radius, int subdivisions, std::vector<GLfloat> &vertexData); //20 * 4^subdivisions triangles
+void generateRoundedBox(const glm::vec3 &halfExtents, float cornerRadius, int cornerSegments, std::vector<GLfloat> &vertexData);
+
+//how far the flat triangles can be from the true curved surface, in world units - used to pick levels of detail
+//  - a flat edge across angle a on a circle of radius r is at most r * (1 - cos(a / 2)) inside it
+float icosphereError(float radius, int subdivisions);
+float roundedBoxError(float cornerRadius, int cornerSegments);
+// end::proceduralMesh[]
+
+#endif
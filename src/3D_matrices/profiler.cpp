@@ -0,0 +1,137 @@
+#include "profiler.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+const char *framePhaseName(FramePhase phase)
+{
+	switch (phase)
+	{
+	case PHASE_INPUT: return "input";
+	case PHASE_SIMULATION: return "simulation";
+	case PHASE_PRE_RENDER: return "preRender";
+	case PHASE_RENDER: return "render";
+	case PHASE_SWAP: return "swap";
+	case PHASE_FRAME: return "frame";
+	default: return "unknown";
+	}
+}
+
+// tag::recording[]
+FrameProfiler::FrameProfiler()
+	: current(0), framesTotal(0), frameOpen(false), frameStart(0)
+{
+	for (int phase = 0; phase < PHASE_COUNT; phase++)
+		for (size_t i = 0; i < historySize; i++)
+			samples[phase][i] = 0.0f;
+}
+
+void FrameProfiler::beginFrame()
+{
+	for (int phase = 0; phase < PHASE_COUNT; phase++)
+		samples[phase][current] = 0.0f;
+	frameOpen = true;
+	frameStart = nowNanoseconds();
+}
+
+void FrameProfiler::endFrame()
+{
+	record(PHASE_FRAME, nowNanoseconds() - frameStart);
+	current = (current + 1) % historySize;
+	framesTotal++;
+	frameOpen = false;
+}
+
+void FrameProfiler::record(FramePhase phase, long long nanoseconds)
+{
+	samples[phase][current] += (float)(nanoseconds * 1e-6);
+}
+// end::recording[]
+
+SampleSummary FrameProfiler::summary(FramePhase phase) const
+{
+	std::vector<double> values;
+	values.reserve(framesInRing());
+	for (size_t i = 0; i < framesInRing(); i++)
+		values.push_back(samples[phase][(oldestFrame() + i) % historySize]);
+	return summariseSamples(values);
+}
+
+// tag::printSummary[]
+void FrameProfiler::printSummary() const
+{
+	std::cout << "Frame timings over the last " << framesInRing() << " frames (ms):\n";
+	std::cout << std::left << std::setw(12) << "phase" << std::right
+	          << std::setw(9) << "min" << std::setw(9) << "avg" << std::setw(9) << "p50"
+	          << std::setw(9) << "p95" << std::setw(9) << "p99" << std::setw(9) << "max" << "\n";
+	std::cout << std::fixed << std::setprecision(3);
+	for (int phase = 0; phase < PHASE_COUNT; phase++)
+	{
+		SampleSummary stats = summary((FramePhase)phase);
+		std::cout << std::left << std::setw(12) << framePhaseName((FramePhase)phase) << std::right
+		          << std::setw(9) << stats.min << std::setw(9) << stats.mean << std::setw(9) << stats.p50
+		          << std::setw(9) << stats.p95 << std::setw(9) << stats.p99 << std::setw(9) << stats.max << "\n";
+	}
+	std::cout << std::defaultfloat << std::setprecision(6);
+}
+// end::printSummary[]
+
+// tag::writeReport[]
+bool FrameProfiler::writeReport(const std::string &filePath) const
+{
+	bool json = filePath.size() >= 5 && filePath.compare(filePath.size() - 5, 5, ".json") == 0;
+	bool written = json ? writeJson(filePath) : writeCsv(filePath);
+	if (written)
+		std::cout << "Frame timings written to " << filePath << std::endl;
+	else
+		std::cerr << "Frame timings could not be written - cannot write file " << filePath << std::endl;
+	return written;
+}
+
+//one row per frame, oldest first
+bool FrameProfiler::writeCsv(const std::string &filePath) const
+{
+	std::ofstream file(filePath);
+	if (!file)
+		return false;
+
+	file << "frame";
+	for (int phase = 0; phase < PHASE_COUNT; phase++)
+		file << "," << framePhaseName((FramePhase)phase) << "_ms";
+	file << "\n";
+
+	size_t firstFrameNumber = framesTotal - framesInRing();
+	for (size_t i = 0; i < framesInRing(); i++)
+	{
+		file << firstFrameNumber + i;
+		for (int phase = 0; phase < PHASE_COUNT; phase++)
+			file << "," << samples[phase][(oldestFrame() + i) % historySize];
+		file << "\n";
+	}
+	return (bool)file;
+}
+
+//summary statistics per phase, plus the raw frames
+bool FrameProfiler::writeJson(const std::string &filePath) const
+{
+	std::ofstream file(filePath);
+	if (!file)
+		return false;
+
+	file << "{\n  \"framesRecorded\": " << framesTotal << ",\n  \"framesInHistory\": " << framesInRing() << ",\n  \"phases\": {\n";
+	for (int phase = 0; phase < PHASE_COUNT; phase++)
+	{
+		SampleSummary stats = summary((FramePhase)phase);
+		file << "    \"" << framePhaseName((FramePhase)phase) << "\": { \"minMs\": " << stats.min << ", \"avgMs\": " << stats.mean
+		     << ", \"p50Ms\": " << stats.p50 << ", \"p95Ms\": " << stats.p95 << ", \"p99Ms\": " << stats.p99
+		     << ", \"maxMs\": " << stats.max << ",\n      \"frames\": [";
+		for (size_t i = 0; i < framesInRing(); i++)
+			file << (i > 0 ? ", " : "") << samples[phase][(oldestFrame() + i) % historySize];
+		file << "] }" << (phase + 1 < PHASE_COUNT ? "," : "") << "\n";
+	}
+	file << "  }\n}\n";
+	return (bool)file;
+}
+// end::writeReport[]
@@ -0,0 +1,88 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstddef>
+#include <string>
+
+#include "timing.h"
+#include "traceEvents.h"
+
+// tag::FramePhase[]
+//the parts of a frame we time - PHASE_FRAME is the whole frame, start to start
+enum FramePhase
+{
+	PHASE_INPUT = 0,
+	PHASE_SIMULATION,
+	PHASE_PRE_RENDER,
+	PHASE_RENDER,
+	PHASE_SWAP,
+	PHASE_FRAME,
+	PHASE_COUNT
+};
+
+const char *framePhaseName(FramePhase phase);
+// end::FramePhase[]
+
+// tag::FrameProfiler[]
+//per-phase timings for the last historySize frames, kept in a fixed-size ring buffer
+//  - recording is a couple of clock reads and an add, and never allocates, so it can stay on all the time
+//  - statistics are only worked out when asked for (a status line once a second, and a summary on exit)
+class FrameProfiler
+{
+public:
+	static const size_t historySize = 1024;
+
+	FrameProfiler();
+
+	void beginFrame();
+	void endFrame();
+	void record(FramePhase phase, long long nanoseconds); //adds to the phase's time for the current frame
+
+	size_t framesRecorded() const { return framesTotal; }
+	SampleSummary summary(FramePhase phase) const; //in milliseconds, over the frames still in the ring
+
+	void printSummary() const;
+	bool writeReport(const std::string &filePath) const; //CSV, or JSON if filePath ends in .json
+
+private:
+	//once the ring has wrapped, the slot of a frame still being recorded holds a partial frame - leave it out
+	size_t framesInRing() const
+	{
+		size_t usable = frameOpen ? historySize - 1 : historySize;
+		return (framesTotal < usable) ? framesTotal : usable;
+	}
+	size_t oldestFrame() const { return (framesTotal < historySize) ? 0 : (current + (frameOpen ? 1 : 0)) % historySize; }
+	bool writeCsv(const std::string &filePath) const;
+	bool writeJson(const std::string &filePath) const;
+
+	float samples[PHASE_COUNT][historySize]; //milliseconds
+	size_t current;     //ring index of the frame being recorded
+	size_t framesTotal; //frames completed since we started
+	bool frameOpen;     //between beginFrame() and endFrame()
+	long long frameStart;
+};
+
+//times from construction to the end of the enclosing scope - and adds it to the trace, if we're tracing
+class ScopedPhaseTimer
+{
+public:
+	ScopedPhaseTimer(FrameProfiler &profiler, FramePhase phase) : profiler(profiler), phase(phase), start(nowNanoseconds()) {}
+	~ScopedPhaseTimer()
+	{
+		long long end = nowNanoseconds();
+		profiler.record(phase, end - start);
+		if (tracingEnabled.load(std::memory_order_relaxed))
+			traceComplete(framePhaseName(phase), start, end);
+	}
+
+private:
+	ScopedPhaseTimer(const ScopedPhaseTimer &);
+	ScopedPhaseTimer &operator=(const ScopedPhaseTimer &);
+
+	FrameProfiler &profiler;
+	FramePhase phase;
+	long long start;
+};
+// end::FrameProfiler[]
+
+#endif
@@ -0,0 +1,136 @@
+#include "programCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const char programCacheMagic[8] = { 'P', 'O', 'N', 'G', 'P', 'B', 'I', 'N' };
+static const uint32_t programCacheVersion = 1;
+
+bool programBinariesSupported()
+{
+	if (!GLEW_ARB_get_program_binary)
+		return false;
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	return formatCount > 0; //some drivers have the entry points, but no formats to save in
+}
+
+// tag::programCacheKey[]
+//FNV-1a, 64 bit
+static void hashBytes(uint64_t &hash, const void *data, size_t length)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	for (size_t i = 0; i < length; i++)
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+}
+
+static void hashString(uint64_t &hash, const std::string &text)
+{
+	uint64_t length = text.size(); //so "ab" + "c" and "a" + "bc" hash differently
+	hashBytes(hash, &length, sizeof(length));
+	hashBytes(hash, text.data(), text.size());
+}
+
+uint64_t programCacheKey(const std::vector<std::string> &sources, const std::string &defines)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < sources.size(); i++)
+		hashString(hash, sources[i]);
+	hashString(hash, defines);
+
+	const GLenum driverStrings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (int i = 0; i < 3; i++)
+	{
+		const GLubyte *value = glGetString(driverStrings[i]);
+		hashString(hash, value != nullptr ? std::string((const char *)value) : std::string());
+	}
+	return hash;
+}
+// end::programCacheKey[]
+
+// tag::loadCachedProgram[]
+GLuint loadCachedProgram(const std::string &filePath, uint64_t key)
+{
+	if (!programBinariesSupported())
+		return 0;
+
+	std::ifstream file(filePath, std::ios::in | std::ios::binary);
+	if (!file)
+		return 0; //first launch - nothing cached yet
+
+	char magic[8];
+	uint32_t version = 0, binaryFormat = 0, length = 0;
+	uint64_t fileKey = 0;
+	file.read(magic, sizeof(magic));
+	file.read((char *)&version, sizeof(version));
+	file.read((char *)&fileKey, sizeof(fileKey));
+	file.read((char *)&binaryFormat, sizeof(binaryFormat));
+	file.read((char *)&length, sizeof(length));
+	if (!file || memcmp(magic, programCacheMagic, sizeof(magic)) != 0 || version != programCacheVersion)
+	{
+		std::cout << "Program cache " << filePath << " is not a program binary - compiling from source" << std::endl;
+		return 0;
+	}
+	if (fileKey != key)
+	{
+		std::cout << "Program cache " << filePath << " is out of date (shaders or driver changed) - compiling from source" << std::endl;
+		return 0;
+	}
+
+	std::vector<char> binary(length);
+	file.read(binary.data(), length);
+	if (!file)
+	{
+		std::cout << "Program cache " << filePath << " is truncated - compiling from source" << std::endl;
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, (GLenum)binaryFormat, binary.data(), (GLsizei)length);
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE)
+	{
+		std::cout << "Program cache " << filePath << " was rejected by the driver - compiling from source" << std::endl;
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+// end::loadCachedProgram[]
+
+// tag::saveProgramBinary[]
+bool saveProgramBinary(const std::string &filePath, uint64_t key, GLuint program)
+{
+	if (!programBinariesSupported())
+		return false;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return false;
+
+	std::vector<char> binary(length);
+	GLenum binaryFormat = 0;
+	GLsizei written = 0;
+	glGetProgramBinary(program, length, &written, &binaryFormat, binary.data());
+	if (written <= 0)
+		return false;
+
+	std::ofstream file(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cerr << "Program cache could not be saved - cannot write file " << filePath << std::endl;
+		return false;
+	}
+	uint32_t format32 = binaryFormat, length32 = (uint32_t)written;
+	file.write(programCacheMagic, sizeof(programCacheMagic));
+	file.write((const char *)&programCacheVersion, sizeof(programCacheVersion));
+	file.write((const char *)&key, sizeof(key));
+	file.write((const char *)&format32, sizeof(format32));
+	file.write((const char *)&length32, sizeof(length32));
+	file.write(binary.data(), written);
+	return (bool)file;
+}
+// end::saveProgramBinary[]
@@ -0,0 +1,27 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+// tag::programCache[]
+//linked programs saved to disk with glGetProgramBinary, and loaded with glProgramBinary next launch
+//  - the key hashes the shader sources, any defines, and GL_VENDOR / GL_RENDERER / GL_VERSION - a binary
+//    is only good for the exact driver that made it
+//  - everything fails soft: no cache file, a different key, or a binary the driver rejects (drivers may
+//    reject their own binaries after an update) all just mean we compile from source as before
+//
+//file format: "PONGPBIN", uint32 version, uint64 key, uint32 binaryFormat, uint32 length, then length bytes
+bool programBinariesSupported(); //needs a current GL context
+
+uint64_t programCacheKey(const std::vector<std::string> &sources, const std::string &defines); //needs a current GL context
+
+GLuint loadCachedProgram(const std::string &filePath, uint64_t key); //0 if there's no usable binary
+bool saveProgramBinary(const std::string &filePath, uint64_t key, GLuint program); //program must be linked, with the
+                                                                                   //GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+// end::programCache[]
+
+#endif
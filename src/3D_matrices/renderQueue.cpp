@@ -0,0 +1,90 @@
+#include "renderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+// tag::makeSortKey[]
+uint64_t makeSortKey(unsigned layer, unsigned program, unsigned material, unsigned vertexArray, unsigned batch, float depth)
+{
+	depth = std::min(std::max(depth, 0.0f), 1.0f);
+	uint64_t depthBits = (uint64_t)(depth * 16777215.0f);
+	if (layer >= RENDER_LAYER_TRANSPARENT)
+		depthBits = 16777215 - depthBits; //furthest first, so blending comes out right
+
+	return ((uint64_t)(layer & 0xF) << 60) | ((uint64_t)(program & 0xFFF) << 48) | ((uint64_t)(material & 0xFF) << 40)
+	     | ((uint64_t)(vertexArray & 0xFF) << 32) | ((uint64_t)(batch & 0xFF) << 24) | depthBits;
+}
+// end::makeSortKey[]
+
+void RenderQueue::reset(size_t bucketCount)
+{
+	if (buckets.size() < bucketCount)
+		buckets.resize(bucketCount);
+	for (size_t i = 0; i < buckets.size(); i++)
+		buckets[i].clear(); //keeps the memory, so a steady scene doesn't allocate
+}
+
+// tag::sort[]
+void RenderQueue::sort()
+{
+	sorted.clear();
+	for (size_t b = 0; b < buckets.size(); b++)
+		for (size_t i = 0; i < buckets[b].size(); i++)
+		{
+			SortItem item = { buckets[b][i].key, (uint32_t)b, (uint32_t)i };
+			sorted.push_back(item);
+		}
+	scratch.resize(sorted.size());
+
+	//least significant byte first - each pass is a stable counting sort, so earlier passes' order survives ties
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t counts[256];
+		memset(counts, 0, sizeof(counts));
+		for (size_t i = 0; i < sorted.size(); i++)
+			counts[(sorted[i].key >> shift) & 0xFF]++;
+
+		//every key has the same byte here - nothing to do
+		if (sorted.empty() || counts[(sorted[0].key >> shift) & 0xFF] == sorted.size())
+			continue;
+
+		size_t offset = 0;
+		for (int digit = 0; digit < 256; digit++)
+		{
+			size_t count = counts[digit];
+			counts[digit] = offset;
+			offset += count;
+		}
+		for (size_t i = 0; i < sorted.size(); i++)
+			scratch[counts[(sorted[i].key >> shift) & 0xFF]++] = sorted[i];
+		sorted.swap(scratch);
+	}
+}
+// end::sort[]
+
+// tag::execute[]
+void RenderQueue::execute(InstancedRenderer &renderer)
+{
+	//a batch can turn up in more than one run (in two layers, say), so count first and allocate each batch once
+	batchCounts.assign(renderer.batchCount(), 0);
+	stateGroups = 0;
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		batchCounts[sortKeyBatch(sorted[i].key)]++;
+		if (i == 0 || sortKeyState(sorted[i].key) != sortKeyState(sorted[i - 1].key))
+			stateGroups++;
+	}
+
+	renderer.beginFrame(sorted.size());
+	batchCursors.resize(batchCounts.size());
+	for (size_t b = 0; b < batchCounts.size(); b++)
+		batchCursors[b] = renderer.allocate((int)b, batchCounts[b]);
+
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		InstanceData *&cursor = batchCursors[sortKeyBatch(sorted[i].key)];
+		if (cursor != nullptr)
+			*cursor++ = buckets[sorted[i].bucket][sorted[i].index].instance;
+	}
+}
+// end::execute[]
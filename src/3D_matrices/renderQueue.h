@@ -0,0 +1,79 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "instancedRenderer.h"
+
+// tag::SortKey[]
+//a draw's 64-bit sort key - sorting by it puts draws in the order that changes the least state
+//  bits, most significant first:
+//  - layer (4)         opaque first, then transparent
+//  - program (12)
+//  - material (8)
+//  - vertex array (8)
+//  - batch (8)         which mesh
+//  - depth (24)        front to back in opaque layers, for early-Z; back to front in transparent ones
+enum RenderLayer
+{
+	RENDER_LAYER_OPAQUE = 0,
+	RENDER_LAYER_TRANSPARENT = 8
+};
+
+//depth is the distance along the view direction, scaled so the far plane is 1
+uint64_t makeSortKey(unsigned layer, unsigned program, unsigned material, unsigned vertexArray, unsigned batch, float depth);
+
+inline unsigned sortKeyBatch(uint64_t key) { return (unsigned)(key >> 24) & 0xFF; }
+inline uint64_t sortKeyState(uint64_t key) { return key >> 24; } //everything but depth - draws with the same state
+// end::SortKey[]
+
+// tag::RenderQueue[]
+//one draw of one instance, as game code submits it
+struct DrawPacket
+{
+	uint64_t key;
+	InstanceData instance;
+};
+
+typedef std::vector<DrawPacket> CommandBucket;
+
+//collects draw packets, sorts them by key, and hands them to the instanced renderer in that order
+//  - packets go into buckets; whoever fills a bucket owns it until sort(), so jobs on different threads
+//    can each fill their own without locking
+//  - sort() gathers every bucket and radix sorts the keys - 8 bits a pass, skipping passes where every key
+//    has the same byte, which with one layer and program is most of them
+//  - execute() writes each batch's instances in sorted order, so within a mesh they're drawn front to back
+class RenderQueue
+{
+public:
+	RenderQueue() : stateGroups(0) {}
+
+	void reset(size_t bucketCount); //empties every bucket - at the start of the frame
+	CommandBucket &bucket(size_t index) { return buckets[index]; }
+
+	void sort();
+	void execute(InstancedRenderer &renderer); //calls renderer.beginFrame() and fills each batch's instances
+
+	size_t size() const { return sorted.size(); }
+	size_t stateGroupCount() const { return stateGroups; } //runs of packets sharing everything but depth, last execute()
+
+private:
+	struct SortItem
+	{
+		uint64_t key;
+		uint32_t bucket;
+		uint32_t index;
+	};
+
+	std::vector<CommandBucket> buckets;
+	std::vector<SortItem> sorted;
+	std::vector<SortItem> scratch;
+	std::vector<size_t> batchCounts;
+	std::vector<InstanceData *> batchCursors;
+	size_t stateGroups;
+};
+// end::RenderQueue[]
+
+#endif
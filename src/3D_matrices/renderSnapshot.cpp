@@ -0,0 +1,44 @@
+#include "renderSnapshot.h"
+#include "timing.h"
+
+// tag::captureSnapshot[]
+void captureSnapshot(const EntityStore &entities, long long tick, double tickLength, RenderSnapshot &snapshot)
+{
+	snapshot.prevX.assign(entities.prevX.begin(), entities.prevX.end());
+	snapshot.prevY.assign(entities.prevY.begin(), entities.prevY.end());
+	snapshot.prevZ.assign(entities.prevZ.begin(), entities.prevZ.end());
+	snapshot.posX.assign(entities.posX.begin(), entities.posX.end());
+	snapshot.posY.assign(entities.posY.begin(), entities.posY.end());
+	snapshot.posZ.assign(entities.posZ.begin(), entities.posZ.end());
+	snapshot.halfX.assign(entities.halfX.begin(), entities.halfX.end());
+	snapshot.halfY.assign(entities.halfY.begin(), entities.halfY.end());
+	snapshot.halfZ.assign(entities.halfZ.begin(), entities.halfZ.end());
+	snapshot.kind.assign(entities.kind.begin(), entities.kind.end());
+
+	//the paddles are created first, so in practice this is every entity after them
+	snapshot.ballsBegin = snapshot.kind.size();
+	while (snapshot.ballsBegin > 0 && snapshot.kind[snapshot.ballsBegin - 1] == ENTITY_BALL)
+		snapshot.ballsBegin--;
+
+	snapshot.tick = tick;
+	snapshot.publishTime = nowNanoseconds();
+	snapshot.tickLength = tickLength;
+}
+// end::captureSnapshot[]
+
+static void interpolateAxis(const FloatArray &previous, const FloatArray &current, float alpha, FloatArray &out)
+{
+	out.resize(current.size());
+	const float *p = previous.data();
+	const float *c = current.data();
+	float *o = out.data();
+	for (size_t i = 0; i < current.size(); i++) //simple enough for the compiler to vectorise
+		o[i] = p[i] + (c[i] - p[i]) * alpha;
+}
+
+void RenderSnapshot::interpolatePositions(float alpha, FloatArray &x, FloatArray &y, FloatArray &z) const
+{
+	interpolateAxis(prevX, posX, alpha, x);
+	interpolateAxis(prevY, posY, alpha, y);
+	interpolateAxis(prevZ, posZ, alpha, z);
+}
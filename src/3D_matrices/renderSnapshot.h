@@ -0,0 +1,41 @@
+#ifndef RENDER_SNAPSHOT_H
+#define RENDER_SNAPSHOT_H
+
+#include <cstddef>
+#include <vector>
+
+#include "entityStore.h"
+
+// tag::RenderSnapshot[]
+//everything render() needs from the simulation, copied out at the end of a tick
+//  - once published it is never changed, so the renderer can use it while the simulation carries on
+struct RenderSnapshot
+{
+	FloatArray prevX, prevY, prevZ; //positions at the start of the tick
+	FloatArray posX, posY, posZ;    //positions at the end of the tick
+	FloatArray halfX, halfY, halfZ; //half extents of each bounding box, for culling
+	std::vector<EntityKind> kind;
+	size_t ballsBegin = 0; //everything from here on is a ball - culled as spheres, the rest as boxes
+
+	long long tick = 0;        //the tick this is the result of
+	long long publishTime = 0; //nowNanoseconds() when the tick finished
+	double tickLength = 0.0;   //seconds
+
+	size_t size() const { return kind.size(); }
+
+	glm::vec3 interpolatedPosition(size_t index, float alpha) const
+	{
+		return glm::vec3(prevX[index] + (posX[index] - prevX[index]) * alpha,
+		                 prevY[index] + (posY[index] - prevY[index]) * alpha,
+		                 prevZ[index] + (posZ[index] - prevZ[index]) * alpha);
+	}
+
+	//every position at once, as structure-of-arrays - x, y and z are resized to fit
+	void interpolatePositions(float alpha, FloatArray &x, FloatArray &y, FloatArray &z) const;
+};
+
+//copy the renderable state out of entities - reuses snapshot's storage, so this doesn't allocate once warmed up
+void captureSnapshot(const EntityStore &entities, long long tick, double tickLength, RenderSnapshot &snapshot);
+// end::RenderSnapshot[]
+
+#endif
@@ -0,0 +1,397 @@
+#include "shaderManager.h"
+#include "glState.h"
+#include "programCache.h"
+#include "timing.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <thread>
+
+#include <sys/stat.h>
+
+#if defined(__linux__)
+	#include <sys/inotify.h>
+	#include <unistd.h>
+	#include <cerrno>
+	#define SHADER_MANAGER_INOTIFY
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+	#define GL_COMPLETION_STATUS_KHR 0x91B1 //same value as GL_COMPLETION_STATUS_ARB
+#endif
+
+std::string readTextFile(const std::string &filePath)
+{
+	std::ifstream fileStream(filePath, std::ios::in | std::ios::binary);
+	if (!fileStream)
+	{
+		std::cerr << "Shader could not be loaded - cannot read file " << filePath << ". File does not exist." << std::endl;
+		return "";
+	}
+	return std::string((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
+}
+
+static std::time_t modificationTime(const std::string &filePath)
+{
+	struct stat info;
+	if (stat(filePath.c_str(), &info) != 0)
+		return 0;
+	return info.st_mtime;
+}
+
+static std::string directoryOf(const std::string &filePath)
+{
+	size_t slash = filePath.find_last_of("/\\");
+	return slash == std::string::npos ? "." : filePath.substr(0, slash);
+}
+
+static std::string fileNameOf(const std::string &filePath)
+{
+	size_t slash = filePath.find_last_of("/\\");
+	return slash == std::string::npos ? filePath : filePath.substr(slash + 1);
+}
+
+ShaderManager::ShaderManager() : parallel(false), watching(false), reloads(0), inotifyFd(-1), lastPollTime(0)
+{
+}
+
+ShaderManager::~ShaderManager()
+{
+#if defined(SHADER_MANAGER_INOTIFY)
+	if (inotifyFd >= 0)
+		close(inotifyFd);
+#endif
+}
+
+// tag::initialise[]
+void ShaderManager::initialise(bool watchFiles)
+{
+	parallel = GLEW_ARB_parallel_shader_compile || glewGetExtension("GL_KHR_parallel_shader_compile");
+	if (GLEW_ARB_parallel_shader_compile)
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFFu); //as many as the driver likes
+
+	watching = watchFiles;
+#if defined(SHADER_MANAGER_INOTIFY)
+	if (watching)
+	{
+		inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (inotifyFd < 0)
+			std::cerr << "inotify unavailable - checking shader modification times instead" << std::endl;
+	}
+#endif
+	std::cout << "Shader manager: " << (parallel ? "parallel compile" : "compile status polled a frame later")
+	          << (watching ? (inotifyFd >= 0 ? ", watching shaders with inotify" : ", watching shader modification times") : "") << std::endl;
+}
+// end::initialise[]
+
+void ShaderManager::shutdown()
+{
+	for (size_t i = 0; i < programs.size(); i++)
+	{
+		Program &program = programs[i];
+		if (program.building)
+		{
+			glDeleteShader(program.build.vertexShader);
+			glDeleteShader(program.build.fragmentShader);
+			glDeleteProgram(program.build.program);
+		}
+		if (program.current != 0)
+			glState.deleteProgram(program.current);
+	}
+	programs.clear();
+#if defined(SHADER_MANAGER_INOTIFY)
+	if (inotifyFd >= 0)
+		close(inotifyFd);
+	inotifyFd = -1;
+#endif
+}
+
+// tag::addProgram[]
+int ShaderManager::addProgram(const std::string &name, const std::string &vertexPath, const std::string &fragmentPath,
+                              const std::string &cachePath, ReadyCallback onReady)
+{
+	Program program;
+	program.name = name;
+	program.vertexPath = vertexPath;
+	program.fragmentPath = fragmentPath;
+	program.cachePath = cachePath;
+	program.onReady = onReady;
+	program.current = 0;
+	program.building = false;
+	program.stale = false;
+	program.vertexTime = modificationTime(vertexPath);
+	program.fragmentTime = modificationTime(fragmentPath);
+	programs.push_back(program);
+	Program &added = programs.back();
+
+	if (watching)
+	{
+		watchFile(vertexPath);
+		watchFile(fragmentPath);
+	}
+
+	//a binary from the last launch skips building altogether - if the shaders and driver are the same
+	if (!cachePath.empty())
+	{
+		long long startTime = nowNanoseconds();
+		std::vector<std::string> sources;
+		sources.push_back(readTextFile(vertexPath));
+		sources.push_back(readTextFile(fragmentPath));
+		added.current = loadCachedProgram(cachePath, programCacheKey(sources, ""));
+		if (added.current != 0)
+		{
+			std::cout << "GLSL program " << name << " loaded from " << cachePath << " OK! GLUint is: " << added.current
+			          << " (" << (nowNanoseconds() - startTime) * 1e-6 << " ms)" << std::endl;
+			added.onReady(added.current);
+			return (int)programs.size() - 1;
+		}
+	}
+
+	startBuild(added);
+	return (int)programs.size() - 1;
+}
+// end::addProgram[]
+
+// tag::startBuild[]
+static GLuint startCompile(GLenum type, const std::string &source)
+{
+	GLuint shader = glCreateShader(type);
+	const char *text = source.c_str();
+	glShaderSource(shader, 1, &text, NULL);
+	glCompileShader(shader); //returns straight away - as long as we don't ask how it went
+	return shader;
+}
+
+void ShaderManager::startBuild(Program &program)
+{
+	Build &build = program.build;
+	build.startTime = nowNanoseconds();
+
+	std::vector<std::string> sources;
+	sources.push_back(readTextFile(program.vertexPath));
+	sources.push_back(readTextFile(program.fragmentPath));
+	build.cacheKey = programCacheKey(sources, "");
+
+	build.vertexShader = startCompile(GL_VERTEX_SHADER, sources[0]);
+	build.fragmentShader = startCompile(GL_FRAGMENT_SHADER, sources[1]);
+
+	//link straight away too - the driver queues it behind the compiles
+	build.program = glCreateProgram();
+	glAttachShader(build.program, build.vertexShader);
+	glAttachShader(build.program, build.fragmentShader);
+	if (GLEW_ARB_get_program_binary && !program.cachePath.empty())
+		glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); //so we can save it to the program cache
+	glLinkProgram(build.program);
+
+	program.building = true;
+}
+// end::startBuild[]
+
+bool ShaderManager::buildFinished(const Build &build) const
+{
+	if (!parallel)
+		return true; //we'll have to wait in finishBuild - but at least every other build was started first
+	GLint complete = GL_FALSE;
+	glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &complete);
+	return complete == GL_TRUE;
+}
+
+static void printInfoLog(GLuint object, bool isProgram, const std::string &what)
+{
+	GLint infoLogLength = 0;
+	if (isProgram)
+		glGetProgramiv(object, GL_INFO_LOG_LENGTH, &infoLogLength);
+	else
+		glGetShaderiv(object, GL_INFO_LOG_LENGTH, &infoLogLength);
+	std::vector<GLchar> infoLog(infoLogLength + 1, 0);
+	if (isProgram)
+		glGetProgramInfoLog(object, infoLogLength, NULL, infoLog.data());
+	else
+		glGetShaderInfoLog(object, infoLogLength, NULL, infoLog.data());
+	std::cerr << what << ":\n" << infoLog.data() << std::endl;
+}
+
+// tag::finishBuild[]
+void ShaderManager::finishBuild(Program &program)
+{
+	Build &build = program.build;
+	program.building = false;
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(build.program, GL_LINK_STATUS, &status);
+	bool linked = (status == GL_TRUE);
+	if (!linked)
+	{
+		//the compile logs say why, more usefully than the link log
+		glGetShaderiv(build.vertexShader, GL_COMPILE_STATUS, &status);
+		if (status == GL_FALSE)
+			printInfoLog(build.vertexShader, false, "Compile failure in vertex shader " + program.vertexPath);
+		glGetShaderiv(build.fragmentShader, GL_COMPILE_STATUS, &status);
+		if (status == GL_FALSE)
+			printInfoLog(build.fragmentShader, false, "Compile failure in fragment shader " + program.fragmentPath);
+		printInfoLog(build.program, true, "Linker failure in " + program.name);
+	}
+
+	glDetachShader(build.program, build.vertexShader);
+	glDetachShader(build.program, build.fragmentShader);
+	glDeleteShader(build.vertexShader);
+	glDeleteShader(build.fragmentShader);
+
+	if (!linked)
+	{
+		glDeleteProgram(build.program);
+		if (program.current != 0)
+			std::cerr << "Keeping the previous build of " << program.name << std::endl;
+		return;
+	}
+
+	//swap - between frames, so no draw ever sees half a program
+	GLuint old = program.current;
+	program.current = build.program;
+	if (old != 0)
+	{
+		glState.deleteProgram(old);
+		reloads++;
+	}
+	std::cout << "GLSL program " << program.name << " built OK! GLUint is: " << program.current
+	          << " (" << (nowNanoseconds() - build.startTime) * 1e-6 << " ms)" << std::endl;
+
+	if (!program.cachePath.empty() && saveProgramBinary(program.cachePath, build.cacheKey, program.current))
+		std::cout << "GLSL program " << program.name << " saved to " << program.cachePath << std::endl;
+	program.onReady(program.current);
+}
+// end::finishBuild[]
+
+// tag::update[]
+void ShaderManager::update()
+{
+	for (size_t i = 0; i < programs.size(); i++)
+	{
+		Program &program = programs[i];
+		if (!program.building || !buildFinished(program.build))
+			continue;
+		finishBuild(program);
+		if (program.stale)
+		{
+			program.stale = false;
+			startBuild(program);
+		}
+	}
+
+	if (watching)
+		pollFileChanges();
+}
+// end::update[]
+
+void ShaderManager::waitUntilReady()
+{
+	for (;;)
+	{
+		bool ready = true;
+		for (size_t i = 0; i < programs.size(); i++)
+		{
+			if (!programs[i].building)
+				continue;
+			if (buildFinished(programs[i].build))
+				finishBuild(programs[i]);
+			else
+				ready = false;
+		}
+		if (ready)
+			break;
+		std::this_thread::yield();
+	}
+
+	for (size_t i = 0; i < programs.size(); i++)
+	{
+		if (programs[i].current == 0)
+		{
+			std::cerr << "GLSL program " << programs[i].name << " failed to build - nothing to draw with" << std::endl;
+			exit(1);
+		}
+	}
+}
+
+// tag::watching[]
+void ShaderManager::watchFile(const std::string &path)
+{
+#if defined(SHADER_MANAGER_INOTIFY)
+	if (inotifyFd < 0)
+		return;
+	//watch the directory, not the file - editors often save by writing a new file and renaming it over the old one
+	std::string directory = directoryOf(path);
+	for (size_t i = 0; i < watchedDirectories.size(); i++)
+		if (watchedDirectories[i] == directory)
+			return;
+	int descriptor = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (descriptor >= 0)
+	{
+		watchDescriptors.push_back(descriptor);
+		watchedDirectories.push_back(directory);
+	}
+#else
+	(void)path;
+#endif
+}
+
+void ShaderManager::pollFileChanges()
+{
+#if defined(SHADER_MANAGER_INOTIFY)
+	if (inotifyFd >= 0)
+	{
+		alignas(struct inotify_event) char buffer[4096];
+		for (;;)
+		{
+			ssize_t length = read(inotifyFd, buffer, sizeof(buffer)); //non-blocking
+			if (length <= 0)
+				break;
+			for (char *cursor = buffer; cursor < buffer + length;)
+			{
+				const struct inotify_event *event = (const struct inotify_event *)cursor;
+				for (size_t i = 0; i < watchDescriptors.size(); i++)
+					if (watchDescriptors[i] == event->wd && event->len > 0)
+						fileChanged(watchedDirectories[i] + "/" + event->name);
+				cursor += sizeof(struct inotify_event) + event->len;
+			}
+		}
+		return;
+	}
+#endif
+
+	//no inotify - look at modification times, but only twice a second
+	long long now = nowNanoseconds();
+	if (now - lastPollTime < 500000000LL)
+		return;
+	lastPollTime = now;
+	for (size_t i = 0; i < programs.size(); i++)
+	{
+		Program &program = programs[i];
+		std::time_t vertexTime = modificationTime(program.vertexPath);
+		std::time_t fragmentTime = modificationTime(program.fragmentPath);
+		if (vertexTime != program.vertexTime || fragmentTime != program.fragmentTime)
+			fileChanged(vertexTime != program.vertexTime ? program.vertexPath : program.fragmentPath);
+	}
+}
+
+void ShaderManager::fileChanged(const std::string &path)
+{
+	std::string changedName = fileNameOf(path);
+	for (size_t i = 0; i < programs.size(); i++)
+	{
+		Program &program = programs[i];
+		if (fileNameOf(program.vertexPath) != changedName && fileNameOf(program.fragmentPath) != changedName)
+			continue;
+		program.vertexTime = modificationTime(program.vertexPath);
+		program.fragmentTime = modificationTime(program.fragmentPath);
+		if (program.building)
+		{
+			program.stale = true; //the build in flight may have read the old file
+			continue;
+		}
+		std::cout << "\n" << changedName << " changed - rebuilding " << program.name << std::endl;
+		startBuild(program);
+	}
+}
+// end::watching[]
@@ -0,0 +1,85 @@
+#ifndef SHADER_MANAGER_H
+#define SHADER_MANAGER_H
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+// tag::ShaderManager[]
+//builds GLSL programs without waiting on the driver, and rebuilds them when their files change
+//  - build() starts every compile and the link straight away, but never asks how they went - asking
+//    (GL_COMPILE_STATUS, GL_LINK_STATUS) makes the driver finish the work there and then
+//  - update(), once a frame, asks each pending build whether it's finished, with GL_COMPLETION_STATUS
+//    (KHR/ARB_parallel_shader_compile) if the driver has it, so the compile runs on the driver's threads
+//    and never holds up a frame; without it, we still only ask a frame after starting
+//  - a program that links replaces the old one between frames, and onReady is called with it; one that
+//    doesn't is reported and thrown away, and the old program carries on - a typo never breaks the running game
+//  - watches the shader files (inotify on Linux, modification times elsewhere), and rebuilds when they change
+//  - with a cache file, a binary from the last launch is used instead of building, if it matches
+class ShaderManager
+{
+public:
+	typedef std::function<void(GLuint program)> ReadyCallback;
+
+	ShaderManager();
+	~ShaderManager();
+
+	void initialise(bool watchFiles); //needs a current GL context
+	void shutdown();
+
+	//returns the program id - onReady is called each time a new build of it is swapped in
+	int addProgram(const std::string &name, const std::string &vertexPath, const std::string &fragmentPath,
+	               const std::string &cachePath, ReadyCallback onReady);
+
+	void update(); //once a frame - polls builds and file changes; never blocks if the driver compiles in parallel
+	void waitUntilReady(); //blocks until every program has finished its first build - exits if one failed
+
+	GLuint program(int id) const { return programs[id].current; }
+	bool parallelCompile() const { return parallel; }
+	long long reloadCount() const { return reloads; }
+
+private:
+	struct Build
+	{
+		GLuint vertexShader, fragmentShader, program;
+		uint64_t cacheKey;
+		long long startTime;
+	};
+
+	struct Program
+	{
+		std::string name, vertexPath, fragmentPath, cachePath;
+		ReadyCallback onReady;
+		GLuint current;
+		bool building;
+		bool stale; //a file changed while building - build again when this one finishes
+		Build build;
+		std::time_t vertexTime, fragmentTime; //for mtime polling
+	};
+
+	void startBuild(Program &program);
+	bool buildFinished(const Build &build) const;
+	void finishBuild(Program &program);
+	void watchFile(const std::string &path);
+	void pollFileChanges();
+	void fileChanged(const std::string &path);
+
+	std::vector<Program> programs;
+	bool parallel;
+	bool watching;
+	long long reloads;
+
+	int inotifyFd; //-1 if not using inotify
+	std::vector<int> watchDescriptors;
+	std::vector<std::string> watchedDirectories; //same order as watchDescriptors
+	long long lastPollTime;
+};
+
+std::string readTextFile(const std::string &filePath); //"" if it can't be read
+// end::ShaderManager[]
+
+#endif
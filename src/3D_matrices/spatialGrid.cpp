@@ -0,0 +1,119 @@
+#include "spatialGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+int32_t SpatialGrid::cellCoordinate(float position) const
+{
+	return (int32_t)std::floor(position / cellSize);
+}
+
+// tag::bucketOf[]
+uint32_t SpatialGrid::bucketOf(int32_t x, int32_t y, int32_t z) const
+{
+	//large primes spread neighbouring cells across the table (Teschner et al. 2003)
+	uint32_t hash = ((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u) ^ ((uint32_t)z * 83492791u);
+	return hash & (uint32_t)(bucketCount() - 1);
+}
+// end::bucketOf[]
+
+// tag::build[]
+void SpatialGrid::build(const EntityStore &entities, float sweepTime)
+{
+	const size_t count = entities.size();
+	const float *position[3] = { entities.posX.data(), entities.posY.data(), entities.posZ.data() };
+	const float *velocity[3] = { entities.velX.data(), entities.velY.data(), entities.velZ.data() };
+	const float *half[3] = { entities.halfX.data(), entities.halfY.data(), entities.halfZ.data() };
+
+	//about two buckets per entity keeps chains short - a power of two so we can mask instead of mod
+	size_t buckets = 16;
+	while (buckets < count * 2)
+		buckets *= 2;
+	bucketStart.assign(buckets + 1, 0);
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		boxMin[axis].resize(count);
+		boxMax[axis].resize(count);
+		cellMin[axis].resize(count);
+		cellMax[axis].resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			float travel = velocity[axis][i] * sweepTime;
+			boxMin[axis][i] = position[axis][i] - half[axis][i] + std::min(travel, 0.0f);
+			boxMax[axis][i] = position[axis][i] + half[axis][i] + std::max(travel, 0.0f);
+			cellMin[axis][i] = cellCoordinate(boxMin[axis][i]);
+			cellMax[axis][i] = cellCoordinate(boxMax[axis][i]);
+		}
+	}
+
+	//pass 1 - count entries per bucket (into bucketStart[bucket + 1], ready for the prefix sum)
+	for (size_t i = 0; i < count; i++)
+		for (int32_t z = cellMin[2][i]; z <= cellMax[2][i]; z++)
+			for (int32_t y = cellMin[1][i]; y <= cellMax[1][i]; y++)
+				for (int32_t x = cellMin[0][i]; x <= cellMax[0][i]; x++)
+					bucketStart[bucketOf(x, y, z) + 1]++;
+
+	//pass 2 - prefix sum gives where each bucket starts
+	for (size_t bucket = 0; bucket < buckets; bucket++)
+		bucketStart[bucket + 1] += bucketStart[bucket];
+
+	//pass 3 - scatter the entries into place
+	entries.resize(bucketStart[buckets]);
+	bucketFill.assign(bucketStart.begin(), bucketStart.end() - 1);
+	for (size_t i = 0; i < count; i++)
+		for (int32_t z = cellMin[2][i]; z <= cellMax[2][i]; z++)
+			for (int32_t y = cellMin[1][i]; y <= cellMax[1][i]; y++)
+				for (int32_t x = cellMin[0][i]; x <= cellMax[0][i]; x++)
+				{
+					Entry &entry = entries[bucketFill[bucketOf(x, y, z)]++];
+					entry.entity = (uint32_t)i;
+					entry.cell[0] = x;
+					entry.cell[1] = y;
+					entry.cell[2] = z;
+				}
+}
+// end::build[]
+
+// tag::findPairs[]
+void SpatialGrid::findPairs(std::vector<CollisionPair> &pairs) const
+{
+	for (size_t bucket = 0; bucket < bucketCount(); bucket++)
+	{
+		for (uint32_t i = bucketStart[bucket]; i < bucketStart[bucket + 1]; i++)
+		{
+			const Entry &first = entries[i];
+			for (uint32_t j = i + 1; j < bucketStart[bucket + 1]; j++)
+			{
+				const Entry &second = entries[j];
+
+				//a bucket can hold several cells that hash alike - only compare entities in the same cell
+				if (first.cell[0] != second.cell[0] || first.cell[1] != second.cell[1] || first.cell[2] != second.cell[2])
+					continue;
+
+				uint32_t a = std::min(first.entity, second.entity);
+				uint32_t b = std::max(first.entity, second.entity);
+
+				bool overlaps = true;
+				bool ownerCell = true;
+				for (int axis = 0; axis < 3 && overlaps; axis++)
+				{
+					float overlapMin = std::max(boxMin[axis][a], boxMin[axis][b]);
+					float overlapMax = std::min(boxMax[axis][a], boxMax[axis][b]);
+					overlaps = overlapMin <= overlapMax;
+
+					//two big boxes can share many cells - only the cell holding the low corner of
+					//  their overlap reports the pair, so it is reported exactly once
+					ownerCell = ownerCell && (cellCoordinate(overlapMin) == first.cell[axis]);
+				}
+
+				if (overlaps && ownerCell)
+				{
+					CollisionPair pair = { a, b };
+					pairs.push_back(pair);
+				}
+			}
+		}
+	}
+}
+// end::findPairs[]
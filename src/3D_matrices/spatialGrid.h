@@ -0,0 +1,61 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "entityStore.h"
+
+// tag::CollisionPair[]
+//two entities (dense indices, a < b) whose bounding boxes overlap
+struct CollisionPair
+{
+	uint32_t a;
+	uint32_t b;
+};
+// end::CollisionPair[]
+
+// tag::SpatialGrid[]
+//broadphase - a uniform grid of cubic cells, stored as a hash table so the world can be any size
+//  - rebuilt from scratch every tick: count entries per bucket, prefix sum, then scatter (a counting sort),
+//    so the entries of each bucket end up contiguous and build() never allocates once warmed up
+//  - entities bigger than a cell (our paddles) are entered in every cell their box touches
+//  - only entities that share a cell are ever compared, so the cost stays close to linear
+//    as long as the cell size is around the size of the common (smallest) objects
+//  - with a sweep time, each box is grown to cover everywhere the entity goes in that time, so
+//    the pairs include everything that might touch during the tick (for continuous collision)
+class SpatialGrid
+{
+public:
+	SpatialGrid() : cellSize(0.25f) {}
+
+	float cellSize; //world units - change freely between ticks
+
+	void build(const EntityStore &entities, float sweepTime = 0.0f);
+	void findPairs(std::vector<CollisionPair> &pairs) const; //each overlapping pair once, using the boxes from build()
+
+	size_t entryCount() const { return entries.size(); }
+	size_t bucketCount() const { return bucketStart.empty() ? 0 : bucketStart.size() - 1; }
+
+private:
+	struct Entry
+	{
+		uint32_t entity;
+		int32_t cell[3];
+	};
+
+	int32_t cellCoordinate(float position) const;
+	uint32_t bucketOf(int32_t x, int32_t y, int32_t z) const;
+
+	FloatArray boxMin[3]; //per entity, the (swept) box used for this build
+	FloatArray boxMax[3];
+	std::vector<int32_t> cellMin[3]; //per entity, range of cells its box covers
+	std::vector<int32_t> cellMax[3];
+	std::vector<uint32_t> bucketStart; //entries of bucket i are [bucketStart[i], bucketStart[i + 1])
+	std::vector<uint32_t> bucketFill;
+	std::vector<Entry> entries;
+};
+// end::SpatialGrid[]
+
+#endif
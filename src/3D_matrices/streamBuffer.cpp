@@ -0,0 +1,141 @@
+#include "streamBuffer.h"
+#include "glState.h"
+
+#include <iostream>
+
+StreamBuffer::StreamBuffer()
+	: bufferObject(0), regionSize(0), region(0), regionUsed(0), persistentlyMapped(false), mapped(nullptr), stalls(0)
+{
+	for (int i = 0; i < framesInFlight; i++)
+		fences[i] = 0;
+}
+
+// tag::create[]
+void StreamBuffer::create(size_t bytesPerFrame)
+{
+	regionSize = (bytesPerFrame + 255) & ~(size_t)255; //keep each region nicely aligned
+	size_t totalSize = regionSize * framesInFlight;
+
+	glGenBuffers(1, &bufferObject);
+	glState.bindBuffer(GL_ARRAY_BUFFER, bufferObject);
+	persistentlyMapped = (GLEW_ARB_buffer_storage != 0);
+	if (persistentlyMapped)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, totalSize, nullptr, flags);
+		mapped = (char *)glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSize, flags);
+		if (mapped == nullptr)
+		{
+			//storage is immutable, so start again with an ordinary buffer
+			glState.bindBuffer(GL_ARRAY_BUFFER, 0);
+			glState.deleteBuffers(1, &bufferObject);
+			glGenBuffers(1, &bufferObject);
+			glState.bindBuffer(GL_ARRAY_BUFFER, bufferObject);
+			persistentlyMapped = false;
+		}
+	}
+	if (!persistentlyMapped)
+		glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+	glState.bindBuffer(GL_ARRAY_BUFFER, 0);
+	regionUsed = 0;
+}
+// end::create[]
+
+void StreamBuffer::destroy()
+{
+	for (int i = 0; i < framesInFlight; i++)
+	{
+		if (fences[i] != 0)
+			glDeleteSync(fences[i]);
+		fences[i] = 0;
+	}
+	if (bufferObject != 0)
+		glState.deleteBuffers(1, &bufferObject); //also unmaps it - GL keeps the storage alive until the GPU is done with it
+	bufferObject = 0;
+	mapped = nullptr;
+}
+
+void StreamBuffer::initialise(size_t bytesPerFrame)
+{
+	create(bytesPerFrame);
+	std::cout << "Stream buffer created OK! GLUint is: " << bufferObject << " (" << framesInFlight << " x " << regionSize
+	          << " bytes, " << (persistentlyMapped ? "persistently mapped" : "mapped each frame") << ")" << std::endl;
+}
+
+void StreamBuffer::shutdown()
+{
+	commit();
+	destroy();
+}
+
+void StreamBuffer::grow(size_t bytesPerFrame)
+{
+	if (bytesPerFrame <= regionSize)
+		return;
+	destroy();
+	create(bytesPerFrame + bytesPerFrame / 2); //room to grow, so we don't recreate it every frame
+}
+
+// tag::beginFrame[]
+void StreamBuffer::beginFrame()
+{
+	region = (region + 1) % framesInFlight;
+	regionUsed = 0;
+
+	GLsync fence = fences[region];
+	if (fence != 0)
+	{
+		//usually signalled long ago; if not, the GPU is a whole ring behind us and we have to wait
+		GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (status == GL_TIMEOUT_EXPIRED)
+		{
+			stalls++;
+			do
+				status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ULL);
+			while (status == GL_TIMEOUT_EXPIRED);
+		}
+		glDeleteSync(fence);
+		fences[region] = 0;
+	}
+}
+// end::beginFrame[]
+
+// tag::allocate[]
+void *StreamBuffer::allocate(size_t bytes, size_t &bufferOffset, size_t alignment)
+{
+	size_t start = (regionUsed + alignment - 1) / alignment * alignment;
+	if (start + bytes > regionSize)
+		return nullptr;
+
+	if (!persistentlyMapped && mapped == nullptr)
+	{
+		//map the rest of this frame's region in one go, so several allocations share one mapping
+		glState.bindBuffer(GL_ARRAY_BUFFER, bufferObject);
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+		mapped = (char *)glMapBufferRange(GL_ARRAY_BUFFER, region * regionSize, regionSize, flags);
+		if (mapped == nullptr)
+			return nullptr;
+	}
+
+	regionUsed = start + bytes;
+	bufferOffset = region * regionSize + start;
+	return persistentlyMapped ? mapped + bufferOffset : mapped + start;
+}
+// end::allocate[]
+
+void StreamBuffer::commit()
+{
+	if (persistentlyMapped || mapped == nullptr)
+		return; //coherent - writes are visible without anything else from us
+	glState.bindBuffer(GL_ARRAY_BUFFER, bufferObject);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+	mapped = nullptr;
+}
+
+void StreamBuffer::endFrame()
+{
+	commit();
+	if (fences[region] != 0)
+		glDeleteSync(fences[region]);
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
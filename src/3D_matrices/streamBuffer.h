@@ -0,0 +1,54 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <cstddef>
+
+#include <GL/glew.h>
+
+// tag::StreamBuffer[]
+//a ring buffer for data we write every frame (instance data, dynamic geometry, ...)
+//  - split into framesInFlight regions; each frame sub-allocates from its own region, and the CPU writes
+//    straight into GPU-visible memory - there's no copy in a staging vector or inside glBufferSubData
+//  - a fence goes in after each frame's draws; before a region is written again we wait on its fence, so we
+//    never overwrite data the GPU hasn't read yet
+//  - with ARB_buffer_storage the buffer is mapped once, persistently and coherently
+//  - without it (plain GL 3.3) each frame maps its region with GL_MAP_UNSYNCHRONIZED_BIT - the fence already
+//    did the synchronising - and unmaps it in commit(), before anything draws from it
+class StreamBuffer
+{
+public:
+	static const int framesInFlight = 3;
+
+	StreamBuffer();
+
+	void initialise(size_t bytesPerFrame); //needs a current GL context
+	void shutdown();
+
+	void beginFrame(); //move to the next region, waiting for the GPU to finish with it if it has to
+	void *allocate(size_t bytes, size_t &bufferOffset, size_t alignment = 16); //nullptr if the region is full
+	void commit(); //finished writing this frame - call before drawing from the buffer
+	void endFrame(); //after the last draw that reads this frame's data
+
+	void grow(size_t bytesPerFrame); //new, bigger buffer - only between endFrame and beginFrame
+
+	GLuint buffer() const { return bufferObject; }
+	size_t capacityPerFrame() const { return regionSize; }
+	bool persistent() const { return persistentlyMapped; }
+	long long stallCount() const { return stalls; } //how often beginFrame had to wait for the GPU
+
+private:
+	void create(size_t bytesPerFrame);
+	void destroy();
+
+	GLuint bufferObject;
+	GLsync fences[framesInFlight];
+	size_t regionSize;
+	int region;
+	size_t regionUsed;
+	bool persistentlyMapped;
+	char *mapped; //whole buffer when persistent; this frame's region when mapped per frame
+	long long stalls;
+};
+// end::StreamBuffer[]
+
+#endif
@@ -0,0 +1,43 @@
+#include "timing.h"
+
+#include <algorithm>
+#include <cmath>
+
+// tag::percentileOfSorted[]
+//nearest-rank percentile of already sorted samples, p in [0,100]
+static double percentileOfSorted(const std::vector<double> &sorted, double p)
+{
+	if (sorted.empty())
+		return 0.0;
+	size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+	if (rank < 1)
+		rank = 1;
+	if (rank > sorted.size())
+		rank = sorted.size();
+	return sorted[rank - 1];
+}
+// end::percentileOfSorted[]
+
+// tag::summariseSamples[]
+SampleSummary summariseSamples(std::vector<double> samples)
+{
+	SampleSummary summary;
+	summary.count = samples.size();
+	if (samples.empty())
+		return summary;
+
+	std::sort(samples.begin(), samples.end());
+
+	double total = 0.0;
+	for (size_t i = 0; i < samples.size(); i++)
+		total += samples[i];
+
+	summary.min = samples.front();
+	summary.max = samples.back();
+	summary.mean = total / samples.size();
+	summary.p50 = percentileOfSorted(samples, 50.0);
+	summary.p95 = percentileOfSorted(samples, 95.0);
+	summary.p99 = percentileOfSorted(samples, 99.0);
+	return summary;
+}
+// end::summariseSamples[]
@@ -0,0 +1,34 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+// tag::nowNanoseconds[]
+//monotonic high resolution clock, in nanoseconds - only differences between two readings mean anything
+inline long long nowNanoseconds()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+// end::nowNanoseconds[]
+
+// tag::SampleSummary[]
+//order statistics over a set of timing samples (all in the units of the samples)
+struct SampleSummary
+{
+	size_t count = 0;
+	double min = 0.0;
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+//samples is taken by value as it gets sorted
+SampleSummary summariseSamples(std::vector<double> samples);
+// end::SampleSummary[]
+
+#endif
@@ -0,0 +1,138 @@
+#include "traceEvents.h"
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> tracingEnabled(false);
+
+// tag::ThreadTrace[]
+struct TraceEvent
+{
+	const char *name;
+	long long start;
+	long long end;
+};
+
+struct ThreadTrace
+{
+	static const size_t maxEvents = 4 * 1024 * 1024; //per thread, so a forgotten trace can't eat all our memory
+
+	int threadId;
+	std::string name;
+	std::vector<TraceEvent> events;
+	size_t dropped = 0;
+};
+
+//every thread's buffer - owned here, not by the thread, so they outlive the threads that wrote them
+static std::mutex threadTracesMutex;
+static std::vector<std::unique_ptr<ThreadTrace> > threadTraces;
+static long long traceStartTime = 0;
+static thread_local ThreadTrace *currentThreadTrace = nullptr;
+
+static ThreadTrace &threadTrace()
+{
+	if (currentThreadTrace == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(threadTracesMutex);
+		threadTraces.push_back(std::unique_ptr<ThreadTrace>(new ThreadTrace()));
+		currentThreadTrace = threadTraces.back().get();
+		currentThreadTrace->threadId = (int)threadTraces.size();
+		currentThreadTrace->name = "thread " + std::to_string(currentThreadTrace->threadId);
+		currentThreadTrace->events.reserve(16384);
+	}
+	return *currentThreadTrace;
+}
+// end::ThreadTrace[]
+
+void startTracing()
+{
+	traceStartTime = nowNanoseconds();
+	tracingEnabled = true;
+}
+
+void setTraceThreadName(const std::string &name)
+{
+	if (!tracingEnabled.load(std::memory_order_relaxed))
+		return; //don't give a thread a buffer it will never write to
+	threadTrace().name = name;
+}
+
+// tag::traceComplete[]
+void traceComplete(const char *name, long long startNanoseconds, long long endNanoseconds)
+{
+	ThreadTrace &trace = threadTrace();
+	if (trace.events.size() >= ThreadTrace::maxEvents)
+	{
+		trace.dropped++;
+		return;
+	}
+	TraceEvent event = { name, startNanoseconds, endNanoseconds };
+	trace.events.push_back(event);
+}
+// end::traceComplete[]
+
+// tag::writeTrace[]
+static void writeJsonString(std::ofstream &file, const std::string &text)
+{
+	file << '"';
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		if (text[i] == '"' || text[i] == '\\')
+			file << '\\';
+		file << text[i];
+	}
+	file << '"';
+}
+
+bool writeTrace(const std::string &filePath)
+{
+	tracingEnabled = false;
+
+	std::ofstream file(filePath);
+	if (!file)
+	{
+		std::cerr << "Trace could not be written - cannot write file " << filePath << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(threadTracesMutex);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"3D_matrices\"}}";
+
+	size_t eventCount = 0;
+	size_t droppedCount = 0;
+	file.setf(std::ios::fixed);
+	file.precision(3); //timestamps are in microseconds - keep nanosecond resolution
+	for (size_t t = 0; t < threadTraces.size(); t++)
+	{
+		const ThreadTrace &trace = *threadTraces[t];
+		file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << trace.threadId << ",\"args\":{\"name\":";
+		writeJsonString(file, trace.name);
+		file << "}}";
+		file << ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << trace.threadId
+		     << ",\"args\":{\"sort_index\":" << trace.threadId << "}}";
+
+		for (size_t e = 0; e < trace.events.size(); e++)
+		{
+			const TraceEvent &event = trace.events[e];
+			file << ",\n{\"name\":";
+			writeJsonString(file, event.name);
+			file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << trace.threadId
+			     << ",\"ts\":" << (event.start - traceStartTime) * 1e-3
+			     << ",\"dur\":" << (event.end - event.start) * 1e-3 << "}";
+		}
+		eventCount += trace.events.size();
+		droppedCount += trace.dropped;
+	}
+	file << "\n]}\n";
+
+	std::cout << "Trace of " << eventCount << " events on " << threadTraces.size() << " threads written to " << filePath;
+	if (droppedCount > 0)
+		std::cout << " (" << droppedCount << " events dropped - buffers were full)";
+	std::cout << std::endl;
+	return (bool)file;
+}
+// end::writeTrace[]
@@ -0,0 +1,46 @@
+#ifndef TRACE_EVENTS_H
+#define TRACE_EVENTS_H
+
+#include <atomic>
+#include <string>
+
+#include "timing.h"
+
+// tag::traceFunctions[]
+//timeline capture in the Chrome trace event format - open the file in chrome://tracing or ui.perfetto.dev
+//  - each thread appends to its own buffer, so recording takes no locks (except once, on a thread's first event)
+//  - while tracing is off a scope costs one atomic load
+extern std::atomic<bool> tracingEnabled;
+
+void startTracing();
+void setTraceThreadName(const std::string &name); //label for the calling thread's row in the viewer - does nothing unless tracing
+void traceComplete(const char *name, long long startNanoseconds, long long endNanoseconds); //name must outlive the trace
+bool writeTrace(const std::string &filePath); //call once the traced threads have finished
+// end::traceFunctions[]
+
+// tag::TraceScope[]
+//records the enclosing scope as one event
+class TraceScope
+{
+public:
+	explicit TraceScope(const char *name) : name(name), start(tracingEnabled.load(std::memory_order_relaxed) ? nowNanoseconds() : 0) {}
+	~TraceScope()
+	{
+		if (start != 0)
+			traceComplete(name, start, nowNanoseconds());
+	}
+
+private:
+	TraceScope(const TraceScope &);
+	TraceScope &operator=(const TraceScope &);
+
+	const char *name;
+	long long start;
+};
+
+#define TRACE_SCOPE_JOIN2(a, b) a##b
+#define TRACE_SCOPE_JOIN(a, b) TRACE_SCOPE_JOIN2(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_SCOPE_JOIN(traceScope, __LINE__)(name)
+// end::TraceScope[]
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// tag::TripleBuffer[]
+//hands the latest version of a T from one writer thread to one reader thread, without locks or waiting
+//  - the writer fills writeBuffer() and calls publish(); the reader calls update() and then uses readBuffer()
+//  - there are three copies: one being written, one being read, and the latest published one in the middle,
+//    so neither side ever touches a copy the other is using, and the reader always gets the newest one
+//  - the writer can publish faster than the reader reads (versions are skipped, never queued), and the
+//    reader can read the same version as often as it likes
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : middle(1), back(2), front(0) {}
+
+	T &writeBuffer() { return slots[back]; }
+
+	void publish()
+	{
+		//swap our finished copy into the middle, marked fresh, and carry on writing into whatever was there
+		back = middle.exchange((uint8_t)(back | freshBit), std::memory_order_acq_rel) & indexMask;
+	}
+
+	//true if a newer version was published since the last update() - readBuffer() now returns it
+	bool update()
+	{
+		if ((middle.load(std::memory_order_relaxed) & freshBit) == 0)
+			return false;
+		front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+		return true;
+	}
+
+	const T &readBuffer() const { return slots[front]; }
+
+private:
+	static const uint8_t freshBit = 0x4;
+	static const uint8_t indexMask = 0x3;
+
+	T slots[3];
+	std::atomic<uint8_t> middle; //index of the middle copy, plus freshBit if the reader hasn't taken it yet
+	uint8_t back;  //only touched by the writer
+	uint8_t front; //only touched by the reader
+};
+// end::TripleBuffer[]
+
+#endif
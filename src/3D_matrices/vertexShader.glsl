@@ -1,29 +1,25 @@
 #version 330
-in vec3 position;
-in vec4 vertexColor;
-out vec4 fragmentColor;
-uniform vec2 Pos1 = vec2(-0.5, -0.5);
-uniform vec2 Pos2 = vec2(-0.5, -0.5);
-uniform vec2 ballPos = vec2(-0.5, -0.5);
+//locations are fixed, so they don't move when the program is rebuilt while we're running
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 vertexColor;
 
+//per instance - one value for each copy of the mesh we draw
+layout(location = 2) in vec4 instanceTransform; //xyz translation, w uniform scale
+layout(location = 3) in vec4 instanceColor;     //multiplied with vertexColor
 
-uniform mat4 modelMatrix      = mat4(1.0);
-uniform mat4 viewMatrix       = mat4(1.0);
-uniform mat4 projectionMatrix = mat4(1.0);
+out vec4 fragmentColor;
 
-  
+//shared by every program, and only updated when the camera changes
+layout(std140) uniform Camera
+{
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	mat4 viewProjectionMatrix;
+};
 
 void main()
 {
-		gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(position, 1.0);
-		fragmentColor = vertexColor;
-
-		gl_Position = vec4(position + Pos1, 0.0, 1.0);
-		fragmentColor = vertexColor;
-
-		gl_Position = vec4(position + Pos2, 0.0, 1.0);
-		fragmentColor = vertexColor;
-
- 		gl_Position = vec4(position + ballPos, 0.0, 1.0);
+	vec3 worldPosition = position * instanceTransform.w + instanceTransform.xyz;
+	gl_Position = viewProjectionMatrix * vec4(worldPosition, 1.0);
+	fragmentColor = vertexColor * instanceColor;
 }
-